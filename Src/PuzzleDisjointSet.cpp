@@ -37,6 +37,28 @@ void PuzzleDisjointSet::make_set(int new_id){
     set_count++;
 }
 
+void PuzzleDisjointSet::seed(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations) {
+    int rep = -1;
+    for(int i = 0; i<locations.rows; i++){
+        for(int j=0; j<locations.cols; j++){
+            int id = locations(i,j);
+            if(id == -1) continue;
+            if(rep == -1){
+                rep = id;
+            }
+            else {
+                sets[id].representative = rep;
+                set_count--;
+            }
+        }
+    }
+    if(rep == -1) return;
+    
+    sets[rep].locations = locations.clone();
+    sets[rep].rotations = rotations.clone();
+    csets.insert(csets.begin(), rep);
+}
+
 void PuzzleDisjointSet::init_join(PuzzleDisjointSet::join_context& c, int a, int b, int how_a, int how_b) {
     c.a = a;
     c.b = b;
@@ -293,3 +315,27 @@ PuzzleDisjointSet::forest PuzzleDisjointSet::get(int id){
 bool PuzzleDisjointSet::in_one_set(){
     return (1==set_count);
 }
+
+int PuzzleDisjointSet::set_size(int rep){
+    int size = 0;
+    for(int i = 0; i<sets[rep].locations.size[0]; i++){
+        for(int j=0; j<sets[rep].locations.size[1]; j++){
+            if(sets[rep].locations(i,j) != -1) size++;
+        }
+    }
+    return size;
+}
+
+int PuzzleDisjointSet::largest_set(){
+    int largest = 0;
+    int largest_size = 0;
+    for(uint i = 0; i<sets.size(); i++){
+        if(sets[i].representative != -1) continue;
+        int size = set_size(i);
+        if(size > largest_size){
+            largest = i;
+            largest_size = size;
+        }
+    }
+    return largest;
+}
@@ -51,6 +51,8 @@ private:
     cv::Point find_location(cv::Mat_<int>, int number );
 public:
     PuzzleDisjointSet(params& user_params, int number, match_checker edge_checker, void* match_check_data);
+    // joins all of the pieces in the given grid into one set, arranged as given.  Must be called before any other joins.
+    void seed(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations);
     void init_join(join_context& context, int a, int b, int how_a, int how_b);
     bool compute_join(join_context& context);
     void complete_join(join_context& context);
@@ -64,6 +66,10 @@ public:
     int collection_set_count();
     bool in_same_set(int a, int b);
     bool in_one_set();
+    // returns the number of pieces in the set with the given representative
+    int set_size(int rep);
+    // returns the representative of the set containing the most pieces
+    int largest_set();
     forest get(int id);
     void finish();    
 };
@@ -0,0 +1,17 @@
+/*
+ * alloc_counter.h
+ *
+ * Counts the heap allocations made through operator new, so that allocations in hot loops can be
+ * reported.  Allocations made by OpenCV (cv::fastMalloc) or malloc are not counted.
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+class alloc_counter {
+public:
+    // Number of allocations made by any thread since the program started
+    static unsigned long long count();
+};
+
+#endif /* ALLOC_COUNTER_H */
@@ -0,0 +1,180 @@
+/*
+ * anneal.cpp
+ *
+ * Simulated annealing refinement of a solved arrangement of pieces.
+ */
+
+#include "anneal.h"
+
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include "omp.h"
+
+#include "logger.h"
+
+// The temperature falls geometrically from the starting temperature to this fraction of it.
+#define FINAL_TEMPERATURE_RATIO 0.001
+// How many moves are made between checks of the clock.
+#define MOVES_PER_CLOCK_CHECK 1024
+
+// Score of the edges around two cells, counting the pair between them (if any) once.
+static double cells_score(const score_table& costs, cv::Mat_<int>& locs, cv::Mat_<int>& rots, cv::Point a, cv::Point b) {
+    if (a == b) {
+        return costs.cell_score(locs, rots, a.y, a.x);
+    }
+    return costs.cell_score(locs, rots, a.y, a.x) + costs.cell_score(locs, rots, b.y, b.x)
+            - costs.adjacent_score(locs, rots, a, b);
+}
+
+// Give the piece in the cell whichever rotation scores best against its neighbours.
+static void best_rotation(const score_table& costs, cv::Mat_<int>& locs, cv::Mat_<int>& rots, cv::Point cell) {
+    int best = rots(cell.y, cell.x);
+    double best_score = costs.cell_score(locs, rots, cell.y, cell.x);
+    for (int r = 0; r < 4; r++) {
+        rots(cell.y, cell.x) = r;
+        double score = costs.cell_score(locs, rots, cell.y, cell.x);
+        if (score < best_score) {
+            best = r;
+            best_score = score;
+        }
+    }
+    rots(cell.y, cell.x) = best;
+}
+
+bool anneal_solution(const score_table& costs, cv::Mat_<int>& locations, cv::Mat_<int>& rotations, 
+        const std::vector<bool>& fixed_pieces, double seconds, bool verbose) {
+
+    std::vector<cv::Point> cells;
+    for (int i = 0; i < locations.rows; i++) {
+        for (int j = 0; j < locations.cols; j++) {
+            if (locations(i,j) != -1 && !fixed_pieces[locations(i,j)]) {
+                cells.push_back(cv::Point(j,i));
+            }
+        }
+    }
+
+    int pairs;
+    double initial_score = costs.grid_score(locations, rotations, pairs);
+    if (cells.size() < 2 || pairs == 0 || seconds <= 0) {
+        return false;
+    }
+
+    // Start at the mean score of the pairs that can actually fit, so that typical bad moves are
+    // initially accepted with a reasonable probability.
+    double fitting_total = 0.0;
+    int fitting_pairs = 0;
+    for (uint k = 0; k < cells.size(); k++) {
+        cv::Point right(cells[k].x+1, cells[k].y);
+        cv::Point below(cells[k].x, cells[k].y+1);
+        if (right.x < locations.cols) {
+            double score = costs.adjacent_score(locations, rotations, cells[k], right);
+            if (score > 0.0 && score < score_table::IMPOSSIBLE_PENALTY) {
+                fitting_total += score;
+                fitting_pairs++;
+            }
+        }
+        if (below.y < locations.rows) {
+            double score = costs.adjacent_score(locations, rotations, cells[k], below);
+            if (score > 0.0 && score < score_table::IMPOSSIBLE_PENALTY) {
+                fitting_total += score;
+                fitting_pairs++;
+            }
+        }
+    }
+    double start_temperature = (fitting_pairs > 0) ? fitting_total / fitting_pairs : 1.0;
+
+    int threads = omp_get_max_threads();
+    std::vector<cv::Mat_<int> > best_locations(threads);
+    std::vector<cv::Mat_<int> > best_rotations(threads);
+    std::vector<double> best_scores(threads, initial_score);
+    std::vector<long> moves(threads, 0);
+    std::vector<long> accepted(threads, 0);
+
+    double start = omp_get_wtime();
+
+#pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num();
+        std::mt19937 rng(t + 1);
+        std::uniform_int_distribution<int> pick_cell(0, cells.size() - 1);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+        cv::Mat_<int> locs = locations.clone();
+        cv::Mat_<int> rots = rotations.clone();
+        best_locations[t] = locs.clone();
+        best_rotations[t] = rots.clone();
+        double current_score = initial_score;
+        double elapsed = 0.0;
+        double temperature = start_temperature;
+
+        for (long n = 0; elapsed < seconds; n++) {
+            if (n % MOVES_PER_CLOCK_CHECK == 0) {
+                elapsed = omp_get_wtime() - start;
+                temperature = start_temperature * std::pow(FINAL_TEMPERATURE_RATIO, elapsed / seconds);
+            }
+
+            cv::Point a = cells[pick_cell(rng)];
+            cv::Point b = cells[pick_cell(rng)];
+            int old_a = locs(a.y,a.x);
+            int old_b = locs(b.y,b.x);
+            int old_rot_a = rots(a.y,a.x);
+            int old_rot_b = rots(b.y,b.x);
+
+            double before = cells_score(costs, locs, rots, a, b);
+            if (a == b) {
+                // Rotate a single piece
+                rots(a.y,a.x) = (old_rot_a + 1 + (rng() % 3)) % 4;
+            }
+            else {
+                // Swap two pieces, and let each one settle into its best rotation at its new location
+                locs(a.y,a.x) = old_b;
+                locs(b.y,b.x) = old_a;
+                best_rotation(costs, locs, rots, a);
+                best_rotation(costs, locs, rots, b);
+            }
+            double delta = cells_score(costs, locs, rots, a, b) - before;
+            moves[t]++;
+
+            if (delta <= 0.0 || uniform(rng) < std::exp(-delta / temperature)) {
+                accepted[t]++;
+                current_score += delta;
+                if (current_score < best_scores[t]) {
+                    best_scores[t] = current_score;
+                    locs.copyTo(best_locations[t]);
+                    rots.copyTo(best_rotations[t]);
+                }
+            }
+            else {
+                locs(a.y,a.x) = old_a;
+                locs(b.y,b.x) = old_b;
+                rots(a.y,a.x) = old_rot_a;
+                rots(b.y,b.x) = old_rot_b;
+            }
+        }
+    }
+
+    int best = 0;
+    for (int t = 0; t < threads; t++) {
+        if (verbose) {
+            logger::stream() << "Annealing chain " << t << ": " << moves[t] << " moves, " << accepted[t]
+                    << " accepted, best score " << best_scores[t] << std::endl;
+        }
+        if (best_scores[t] < best_scores[best]) {
+            best = t;
+        }
+    }
+
+    // Recompute from scratch to avoid any drift in the running totals
+    double best_score = costs.grid_score(best_locations[best], best_rotations[best], pairs);
+    logger::stream() << "Refinement score: " << initial_score << " -> " << std::min(best_score, initial_score) << std::endl;
+    logger::flush();
+
+    if (best_score < initial_score) {
+        locations = best_locations[best];
+        rotations = best_rotations[best];
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,32 @@
+/*
+ * anneal.h
+ *
+ */
+
+#ifndef ANNEAL_H
+#define ANNEAL_H
+
+#include <vector>
+#include "compat_opencv.h"
+#include "score_table.h"
+
+/** @brief Refine an arrangement of pieces by simulated annealing.
+
+Each available thread runs its own annealing chain, starting from the given arrangement, which swaps
+pieces between occupied cells (re-choosing their rotations) or rotates single pieces.  Arrangements
+are scored as the sum of the scores of all pairs of adjacent edges.  When the time budget runs out, the
+best arrangement found by any chain replaces the input if it scores lower.
+
+Returns true if the arrangement was improved.
+
+@param costs The edge-edge score lookup
+@param locations Grid of piece indices (-1 for empty cells), updated in place
+@param rotations Grid of piece rotations, updated in place
+@param fixed_pieces True for each piece (by index) which must not be moved or rotated
+@param seconds The wall-clock time budget
+@param verbose If true, statistics for each chain are logged
+*/
+bool anneal_solution(const score_table& costs, cv::Mat_<int>& locations, cv::Mat_<int>& rotations, 
+        const std::vector<bool>& fixed_pieces, double seconds, bool verbose);
+
+#endif /* ANNEAL_H */
@@ -0,0 +1,99 @@
+/*
+ * chain_code.cpp
+ *
+ */
+
+#include "chain_code.h"
+
+#include <cstdlib>
+
+// Offsets of the 8 neighbouring pixels, numbered counter clockwise from the right (y is down)
+static const int code_dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int code_dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+// Chain code of the step to each neighbour, indexed by (dy+1)*3 + (dx+1); -1 is not a step
+static const int step_code[9] = { 3, 2, 1, 4, -1, 0, 5, 6, 7 };
+
+chain_code::chain_code() : count(0) {}
+
+chain_code::chain_code(const std::vector<cv::Point>& points) : count(points.size()) {
+    if (points.empty()) {
+        return;
+    }
+    start = points[0];
+    // One spare byte, so that code_at() can always read two bytes
+    codes.assign((3 * count + 7) / 8 + 1, 0);
+    for (uint step = 0; step + 1 < count; step++) {
+        cv::Point delta = points[step + 1] - points[step];
+        int code = -1;
+        if (std::abs(delta.x) <= 1 && std::abs(delta.y) <= 1) {
+            code = step_code[(delta.y + 1) * 3 + delta.x + 1];
+        }
+        if (code == -1) {
+            jumps.push_back(std::make_pair(step, delta));
+            code = 0;
+        }
+        set_code(step, code);
+    }
+}
+
+uint chain_code::code_at(uint step) const {
+    uint bit = 3 * step;
+    uint bits = codes[bit / 8] | (codes[bit / 8 + 1] << 8);
+    return (bits >> (bit % 8)) & 7;
+}
+
+void chain_code::set_code(uint step, uint code) {
+    uint bit = 3 * step;
+    uint bits = code << (bit % 8);
+    codes[bit / 8] |= bits & 0xff;
+    codes[bit / 8 + 1] |= bits >> 8;
+}
+
+uint chain_code::size() const {
+    return count;
+}
+
+bool chain_code::empty() const {
+    return count == 0;
+}
+
+cv::Point chain_code::front() const {
+    return start;
+}
+
+chain_code::const_iterator chain_code::begin() const {
+    return const_iterator(this, 0);
+}
+
+chain_code::const_iterator chain_code::end() const {
+    return const_iterator(this, count);
+}
+
+std::vector<cv::Point> chain_code::decode() const {
+    std::vector<cv::Point> points;
+    points.reserve(count);
+    for (const_iterator it = begin(); it != end(); ++it) {
+        points.push_back(*it);
+    }
+    return points;
+}
+
+chain_code::const_iterator::const_iterator(const chain_code* chain, uint index) :
+        chain(chain), index(index), next_jump(0), point(chain->start) {}
+
+chain_code::const_iterator& chain_code::const_iterator::operator++() {
+    if (index + 1 < chain->count) {
+        if (next_jump < chain->jumps.size() && chain->jumps[next_jump].first == index) {
+            point += chain->jumps[next_jump].second;
+            next_jump++;
+        }
+        else {
+            uint code = chain->code_at(index);
+            point.x += code_dx[code];
+            point.y += code_dy[code];
+        }
+    }
+    index++;
+    return *this;
+}
@@ -0,0 +1,54 @@
+/*
+ * chain_code.h
+ *
+ * Compact storage for contours traced with CHAIN_APPROX_NONE.  Consecutive points of such contours
+ * are 8-connected, so each step is stored as a 3 bit Freeman chain code rather than as a point.
+ */
+
+#ifndef CHAIN_CODE_H
+#define CHAIN_CODE_H
+
+#include <vector>
+#include <stdint.h>
+#include "compat_opencv.h"
+
+class chain_code {
+private:
+    cv::Point start;
+    uint count; // number of points
+    std::vector<uint8_t> codes; // 3 bit chain codes, packed little-endian
+    // Steps that aren't to a neighbouring pixel (e.g. where a duplicate point was removed), by step
+    // index, in increasing order.  Their chain code is ignored.
+    std::vector<std::pair<uint, cv::Point> > jumps;
+
+    uint code_at(uint step) const;
+    void set_code(uint step, uint code);
+public:
+    // Decodes the points in order, without decoding the whole contour into a vector.
+    class const_iterator {
+    private:
+        const chain_code* chain;
+        uint index; // index of the current point
+        uint next_jump; // index into chain->jumps of the next jump at or after the current step
+        cv::Point point;
+    public:
+        const_iterator(const chain_code* chain, uint index);
+        const cv::Point& operator*() const { return point; }
+        const cv::Point* operator->() const { return &point; }
+        const_iterator& operator++();
+        bool operator==(const const_iterator& that) const { return index == that.index; }
+        bool operator!=(const const_iterator& that) const { return index != that.index; }
+    };
+
+    chain_code();
+    chain_code(const std::vector<cv::Point>& points);
+
+    uint size() const;
+    bool empty() const;
+    cv::Point front() const;
+    const_iterator begin() const;
+    const_iterator end() const;
+    std::vector<cv::Point> decode() const;
+};
+
+#endif /* CHAIN_CODE_H */
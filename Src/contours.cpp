@@ -5,6 +5,9 @@
  */
 #include "contours.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 
 piece_order::piece_order(std::string name, bool partition_rows, bool partition_order_asc, bool item_order_asc) :
         name(name), partition_rows(partition_rows), partitions_asc(partition_order_asc), items_asc(item_order_asc) {}
@@ -41,18 +44,11 @@ std::map<std::string,piece_order*> piece_order::items;
 
 contour::contour(cv::Rect _bounds, std::vector<cv::Point> _points) : bounds(_bounds), points(_points) {}
 
-contour_partition::contour_partition(int index) {
-    this->index = index;
-    offset = INT_MAX;
-}
-
-void contour_partition::update_offset(int off) {
-    offset = std::min(offset, off);
+// The y (or x if the contours are partitioned into columns) offset of a contour
+static int partition_offset(const contour& c, piece_order* porder) {
+    return porder->partition_rows ? c.bounds.y : c.bounds.x;
 }
 
-    
-
-
 contour_mgr::contour_mgr(int _container_width, int _container_height, params& _user_params) : user_params(_user_params) {
     container_width = _container_width;
     container_height = _container_height;
@@ -70,59 +66,42 @@ void contour_mgr::add_contour(cv::Rect _bounds, std::vector<cv::Point> _points)
 // but the differences in y of each row (or x of each column) must be less than the estimated piece size multiplied 
 // by the partition factor.  If "landscape" is true, then pieces are ordered top to bottom going left to right.
 void contour_mgr::sort_contours() {
-    // First, partition the contours based on x (or y) position.
-    std::vector<int> labels;
-
     piece_order* porder = piece_order::lookup(user_params.getPieceOrder());
+    float max_gap = user_params.getEstimatedPieceSize() * user_params.getPartitionFactor();
     
-    // partition the contours into rows (or columns if partition_rows==false)
-    cv::partition(contours, labels, [=](const contour& a, const contour& b) {
-        int diff = porder->partition_rows ? (a.bounds.y - b.bounds.y) : (a.bounds.x - b.bounds.x);
-        return std::abs(diff) < user_params.getEstimatedPieceSize() * user_params.getPartitionFactor();
-    });
-
-    // Determine the number of partitions
-    int num_partitions = 0;
-    for (uint i = 0; i < labels.size(); i++) {
-        num_partitions = std::max(labels[i], num_partitions);
-    }
-    num_partitions += 1;
-
-    // Create an array of partition objects
-    contour_partition* partition_array[num_partitions];
-    // Create a sortable vector of partitions
-    std::vector<contour_partition*> partition_vector;
-    for (uint i = 0; i < num_partitions; i++) {
-        partition_array[i] = new contour_partition(i);
-        partition_vector.push_back(partition_array[i]);
-    }
-
-    // Determine the min offset (x or y) for each partition
+    // Partition the contours into rows (or columns if partition_rows==false).  Contours whose y (or x) 
+    // offsets differ by less than max_gap belong to the same partition, as do contours linked through 
+    // a chain of such contours.  So sweeping over the contours in offset order, a new partition starts 
+    // wherever the gap to the previous offset is at least max_gap.  The partitions are found in 
+    // ascending order of their minimum offsets.
+    std::vector<int> by_offset(contours.size());
     for (uint i = 0; i < contours.size(); i++) {
-        int partition = labels[i];
-        int current_offset = partition_array[partition]->offset;
-        int extent = porder->partition_rows ? contours[i].bounds.y : contours[i].bounds.x;
-        partition_array[partition]->offset = std::min(extent, current_offset);
+        by_offset[i] = i;
     }
-
-    // Sort the partitions into offset order
-    std::sort(partition_vector.begin(), partition_vector.end(), [=](contour_partition* a, contour_partition* b) {
-        return porder->partitions_asc ? (a->offset) < (b-> offset) : (b->offset) < (a-> offset);
+    std::sort(by_offset.begin(), by_offset.end(), [&](int a, int b) {
+        return partition_offset(contours[a], porder) < partition_offset(contours[b], porder);
     });
-
-    // Assign the partition order attribute based on the sorted order
-    for (uint i = 0 ; i < partition_vector.size(); i++) {
-        partition_vector[i]->order = i;
+    
+    std::vector<int> labels(contours.size());
+    int num_partitions = 0;
+    for (uint i = 0; i < by_offset.size(); i++) {
+        if (i > 0 && std::abs(partition_offset(contours[by_offset[i]], porder) 
+                - partition_offset(contours[by_offset[i-1]], porder)) >= max_gap) {
+            num_partitions++;
+        }
+        labels[by_offset[i]] = num_partitions;
     }
+    num_partitions++;
 
     int container_dimension = porder->partition_rows ? container_width : container_height;
     // Assign the sort_factor to each contour
     for (uint i = 0; i < contours.size(); i++) {
+        int order = porder->partitions_asc ? labels[i] : num_partitions - 1 - labels[i];
         int offset_in_partition = porder->partition_rows ? contours[i].bounds.x : contours[i].bounds.y;
         if (!porder->items_asc) {
             offset_in_partition = container_dimension - offset_in_partition;
         }
-        contours[i].sort_factor = partition_array[labels[i]]->order * container_dimension + offset_in_partition;
+        contours[i].sort_factor = order * container_dimension + offset_in_partition;
     }
 
     // Sort the contours
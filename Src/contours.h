@@ -39,19 +39,6 @@ public:
     contour(cv::Rect _bounds, std::vector<cv::Point> _points);
 };
 
-// A contour partition is created for each row (or column) found, so that
-// we can sort the contours into the proper order.
-class contour_partition {
-public:
-    int index; // The unsorted partition index
-    int offset; // The offset in x (or y), used to order partition
-    int order; // Order of the partition among other partitions after sorting by offset
-    
-    contour_partition(int index);
-    
-    void update_offset(int off);
-};
-
 // Contour manager 
 class contour_mgr {
 private:
@@ -0,0 +1,81 @@
+/*
+ * dupbench.cpp
+ *
+ * Benchmark of utils::remove_duplicates() against the pairwise scan it replaced, on synthetic piece
+ * outlines.  Built with 'make dupbench', not installed.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <omp.h>
+#include "utils.h"
+
+// The pairwise scan remove_duplicates() used to do, which restarted after every erase
+static std::vector<cv::Point> remove_duplicates_pairwise(std::vector<cv::Point> vec) {
+    bool dupes_found = true;
+    while (dupes_found) {
+        dupes_found = false;
+        for (uint i = 0; i < vec.size() && !dupes_found; i++) {
+            for (uint j = 0; j < vec.size(); j++) {
+                if (j != i && vec[i] == vec[j]) {
+                    dupes_found = true;
+                    vec.erase(vec.begin() + j);
+                    break;
+                }
+            }
+        }
+    }
+    return vec;
+}
+
+// The outline of a square with the given side, traced clockwise, with 'spurs' one pixel spurs which are
+// traced out and back, as findContours() does for one pixel wide protrusions
+static std::vector<cv::Point> outline(int side, int spurs) {
+    std::vector<cv::Point> points;
+    for (int x = 0; x < side; x++) points.push_back(cv::Point(x, 0));
+    for (int y = 0; y < side; y++) points.push_back(cv::Point(side, y));
+    for (int x = side; x > 0; x--) points.push_back(cv::Point(x, side));
+    for (int y = side; y > 0; y--) points.push_back(cv::Point(0, y));
+    std::vector<cv::Point> traced;
+    int spacing = side / spurs;
+    for (uint k = 0; k < points.size(); k++) {
+        traced.push_back(points[k]);
+        if (k < (uint) side && k > 0 && k % spacing == 0) {
+            traced.push_back(cv::Point(points[k].x, -1));
+            traced.push_back(points[k]);
+        }
+    }
+    return traced;
+}
+
+// Average seconds per call of 'remove' on 'contour'
+template<class remove_function>
+static double time_per_call(remove_function remove, const std::vector<cv::Point>& contour, std::vector<cv::Point>& result) {
+    int calls = 0;
+    double start = omp_get_wtime();
+    double elapsed;
+    do {
+        result = remove(contour);
+        calls++;
+        elapsed = omp_get_wtime() - start;
+    } while (elapsed < 0.5);
+    return elapsed / calls;
+}
+
+int main() {
+    int sides[] = {500, 1250, 2500, 5000};
+    std::cout << "  points   pairwise (ms)   hashed (ms)   same result" << std::endl;
+    for (int side : sides) {
+        std::vector<cv::Point> contour = outline(side, 20);
+        std::vector<cv::Point> pairwise;
+        std::vector<cv::Point> hashed;
+        double pairwise_seconds = time_per_call(remove_duplicates_pairwise, contour, pairwise);
+        double hashed_seconds = time_per_call(utils::remove_duplicates, contour, hashed);
+        std::cout << std::setw(8) << contour.size()
+                << std::setw(16) << std::fixed << std::setprecision(3) << pairwise_seconds * 1000
+                << std::setw(14) << hashed_seconds * 1000
+                << std::setw(14) << (pairwise == hashed ? "yes" : "no") << std::endl;
+    }
+    return 0;
+}
@@ -15,47 +15,59 @@
 
 #include "utils.h"
 
+// Maximum number of ICP iterations of compare_aligned()
+#define ICP_ITERATIONS 10
+
 edge::edge(std::vector<cv::Point> edge){
     //original
-    contour = edge;
-    arc_length = cv::arcLength(contour, false);
+    contour = chain_code(edge);
+    arc_length = cv::arcLength(edge, false);
     corner_distance = utils::distance<int>(edge[0], edge[edge.size()-1]);
     //Normalized contours are used for comparisons
-    normalized_contour = normalize(contour);
-    std::vector<cv::Point> copy(contour.begin(),contour.end());
-    std::reverse(copy.begin(), copy.end());
-    //same as normalized contour, but flipped 180 degrees
-    reverse_normalized_contour = normalize(copy);
+    normalized_contour = normalize(edge);
     classify();
 }
 
 std::vector<cv::Point> edge::get_contour() {
-    return contour;
+    return contour.decode();
+}
+
+std::vector<cv::Point2f> edge::reverse_normalized_contour() const {
+    std::vector<cv::Point2f> reverse;
+    reverse.reserve(normalized_contour.size());
+    cv::Point2f end = normalized_contour.back();
+    for (int i = normalized_contour.size() - 1; i >= 0; i--) {
+        reverse.push_back(end - normalized_contour[i]);
+    }
+    return reverse;
 }
 
 //Trying OpenCV's match shapes, hasn't worked as well as my compare2 function.
-double edge::compare(edge that){
+double edge::compare(const edge& that) const {
     //Return large numbers if we know that these shapes simply wont match...
     if(type == OUTER_EDGE || that.type == OUTER_EDGE) return DBL_MAX;
     if(type == that.type) return DBL_MAX;
-    return cv::matchShapes(contour, that.contour, COMPAT_CV_CONTOURS_MATCH_I2, 0);
+    return cv::matchShapes(contour.decode(), that.contour.decode(), COMPAT_CV_CONTOURS_MATCH_I2, 0);
 }
 
 
 //This comparison iterates over every point in "this" contour,
 //finds the closest point in "that" contour and sums those distances up.
 //The end result is the sum divided by length of the 2 contours
-double edge::compare2(edge that){
+double edge::compare2(const edge& that) const {
     //Return large number if an impossible situation is happening
     if(type == OUTER_EDGE || that.type == OUTER_EDGE) return DBL_MAX;
     if(type == that.type) return DBL_MAX;
     double cost=0;
     double total_length =  this->arc_length + that.arc_length;
     
-    for(std::vector<cv::Point2f>::iterator i = normalized_contour.begin(); i!=normalized_contour.end(); i++){
+    //Points of that's reverse normalized contour are that_end - each point of its normalized contour
+    cv::Point2f that_end = that.normalized_contour.back();
+    for(std::vector<cv::Point2f>::const_iterator i = normalized_contour.begin(); i!=normalized_contour.end(); i++){
         double min = 10000000;
-        for(std::vector<cv::Point2f>::iterator j = that.reverse_normalized_contour.begin(); j!=that.reverse_normalized_contour.end(); j++){
-            double dist = std::sqrt(std::pow(i->x - j->x,2) + std::pow(i->y - j->y, 2));
+        for(std::vector<cv::Point2f>::const_iterator j = that.normalized_contour.begin(); j!=that.normalized_contour.end(); j++){
+            cv::Point2f r = that_end - *j;
+            double dist = std::sqrt(std::pow(i->x - r.x,2) + std::pow(i->y - r.y, 2));
             if(dist<min) min = dist;
         }
         
@@ -64,24 +76,79 @@ double edge::compare2(edge that){
     return cost/total_length;
 }
 
-double edge::compare3(edge that, double& cscore, double& escore) {
+edge_view edge::view() const {
+    edge_view v;
+    v.points = normalized_contour.empty() ? NULL : &normalized_contour[0];
+    v.size = normalized_contour.size();
+    v.corner_distance = corner_distance;
+    v.type = type;
+    return v;
+}
+
+std::vector<cv::Point2f> edge::resampled_contour(uint count) const {
+    std::vector<cv::Point2f> resampled;
+    if (normalized_contour.size() < 2 || count < 2) {
+        return normalized_contour;
+    }
+    double length = cv::arcLength(normalized_contour, false);
+    resampled.push_back(normalized_contour.front());
+    // Walk along the contour, emitting a point each time another step of length/(count-1) is covered
+    double step = length / (count - 1);
+    double covered = 0.0;
+    uint k = 1;
+    for (uint i = 1; i < normalized_contour.size() && resampled.size() < count - 1; i++) {
+        cv::Point2f a = normalized_contour[i - 1];
+        cv::Point2f b = normalized_contour[i];
+        double segment = cv::norm(b - a);
+        while (segment > 0 && covered + segment >= k * step && resampled.size() < count - 1) {
+            double t = (k * step - covered) / segment;
+            resampled.push_back(a + (b - a) * (float) t);
+            k++;
+        }
+        covered += segment;
+    }
+    // Rounding can leave the last step short of the end of the contour
+    while (resampled.size() < count - 1) {
+        resampled.push_back(normalized_contour.back());
+    }
+    resampled.push_back(normalized_contour.back());
+    return resampled;
+}
+
+double edge::compare3(const edge& that, double& cscore, double& escore) const {
+    return compare3(view(), that.view(), cscore, escore);
+}
+
+//This comparison iterates over every point in "this" contour,
+//finds the closest point in "that" contour and sums those distances up.
+//It also adds in the squares of the difference in arc_lengths and corner-corner distances.
+double edge::compare3(const edge& that) const {
+    double cscore;
+    double escore;
+    
+    return compare3(view(), that.view(), cscore, escore);
+}
+
+double edge::compare3(const edge_view& a, const edge_view& b, double& cscore, double& escore) {
     //Return large number if an impossible situation is happening
-    if(type == OUTER_EDGE || that.type == OUTER_EDGE || type == that.type) {
+    if(a.type == OUTER_EDGE || b.type == OUTER_EDGE || a.type == b.type) {
         cscore = 0.0;
         escore = DBL_MAX;
         return DBL_MAX;
     }
     
 
-    double corners_diff = this->corner_distance - that.corner_distance;
+    double corners_diff = a.corner_distance - b.corner_distance;
     corners_diff *= corners_diff;
     cscore = corners_diff;
     
     double cost = 0.0;
-    for(std::vector<cv::Point2f>::iterator i = normalized_contour.begin(); i!=normalized_contour.end(); i++){
+    //Points of b's reverse normalized contour are b_end - each point of its normalized contour
+    cv::Point2f b_end = b.points[b.size - 1];
+    for(const cv::Point2f* i = a.points; i != a.points + a.size; i++){
         double min = DBL_MAX;
-        for(std::vector<cv::Point2f>::iterator j = that.reverse_normalized_contour.begin(); j!=that.reverse_normalized_contour.end(); j++) {
-            double dist = utils::distance<float>(*i,*j);
+        for(const cv::Point2f* j = b.points; j != b.points + b.size; j++) {
+            double dist = utils::distance<float>(*i,b_end - *j);
             if(dist<min) min = dist;
         }
         
@@ -92,14 +159,65 @@ double edge::compare3(edge that, double& cscore, double& escore) {
     return cscore + escore;    
 }
 
-//This comparison iterates over every point in "this" contour,
-//finds the closest point in "that" contour and sums those distances up.
-//It also adds in the squares of the difference in arc_lengths and corner-corner distances.
-double edge::compare3(edge that) {
-    double cscore;
-    double escore;
+//ICP: each point of a is paired with the closest point of b's reverse normalized contour, a is moved by
+//the rotation and translation which best fits those pairs (in the least squares sense), and this is
+//repeated until the sum of the distances stops improving.  Each fit starts from the original points of a.
+double edge::compare_aligned(const edge_view& a, const edge_view& b, double& cscore, double& escore) {
+    double score = compare3(a, b, cscore, escore);
+    if (score == DBL_MAX || a.size == 0 || b.size == 0) {
+        return score;
+    }
     
-    return compare3(that, cscore, escore);
+    cv::Point2f b_end = b.points[b.size - 1];
+    double cos_angle = 1.0;
+    double sin_angle = 0.0;
+    cv::Point2d shift(0, 0);
+    // The first pass measures the unmoved edge, which compare3() already did, so it only pairs up the points
+    for (int iteration = 0; iteration <= ICP_ITERATIONS; iteration++) {
+        // Pair up the moved points of a with their closest points, and accumulate the sums the fit needs
+        double cost = 0.0;
+        cv::Point2d a_sum(0, 0);
+        cv::Point2d b_sum(0, 0);
+        double dot = 0.0;
+        double cross = 0.0;
+        for (const cv::Point2f* i = a.points; i != a.points + a.size; i++) {
+            cv::Point2f moved(cos_angle * i->x - sin_angle * i->y + shift.x, sin_angle * i->x + cos_angle * i->y + shift.y);
+            double min = DBL_MAX;
+            cv::Point2f closest;
+            for (const cv::Point2f* j = b.points; j != b.points + b.size; j++) {
+                double dist = utils::distance<float>(moved, b_end - *j);
+                if (dist < min) {
+                    min = dist;
+                    closest = b_end - *j;
+                }
+            }
+            cost += min;
+            a_sum += cv::Point2d(i->x, i->y);
+            b_sum += cv::Point2d(closest.x, closest.y);
+            dot += i->x * closest.x + i->y * closest.y;
+            cross += i->x * closest.y - i->y * closest.x;
+        }
+        if (iteration > 0) {
+            if (cost >= escore) {
+                break;
+            }
+            escore = cost;
+        }
+        if (iteration == ICP_ITERATIONS) {
+            break;
+        }
+        // The best rotation of the centered points of a onto their centered partners, then the translation
+        // which lines up the centroids
+        double n = a.size;
+        dot -= (a_sum.x * b_sum.x + a_sum.y * b_sum.y) / n;
+        cross -= (a_sum.x * b_sum.y - a_sum.y * b_sum.x) / n;
+        double angle = std::atan2(cross, dot);
+        cos_angle = std::cos(angle);
+        sin_angle = std::sin(angle);
+        shift.x = (b_sum.x - (cos_angle * a_sum.x - sin_angle * a_sum.y)) / n;
+        shift.y = (b_sum.y - (sin_angle * a_sum.x + cos_angle * a_sum.y)) / n;
+    }
+    return cscore + escore;
 }
 
 void edge::classify(){
@@ -137,7 +255,7 @@ std::vector<cv::Point> edge::get_translated_contour(int offset_x, int offset_y){
 };
 
 std::vector<cv::Point> edge::get_translated_contour_reverse(int offset_x, int offset_y){
-    return utils::translate_contour(reverse_normalized_contour, offset_x, offset_y);
+    return utils::translate_contour(reverse_normalized_contour(), offset_x, offset_y);
 };
 
 
@@ -179,6 +297,14 @@ edgeType edge::get_type(){
     return type;
 }
 
+const std::vector<cv::Point2f>& edge::get_normalized_contour() const {
+    return normalized_contour;
+}
+
+double edge::get_corner_distance() const {
+    return corner_distance;
+}
+
 
 std::string edge::edge_type_to_s(){
     switch(type){
@@ -11,21 +11,32 @@
 
 #include <iostream>
 #include "compat_opencv.h"
+#include "chain_code.h"
 
 enum edgeType { OUTER_EDGE, TAB, HOLE };
 
+// A non-owning view of the data compared by edge::compare3(), valid for as long as the edge is
+// neither modified nor destroyed.  Comparing views allocates nothing.
+struct edge_view {
+    const cv::Point2f* points; // the normalized contour
+    uint size;
+    double corner_distance;
+    edgeType type;
+};
+
 
 //The paradigm for edges is that if you walked along the edge of the contour
 //from beginning to end, the piece will be to the left, and empty space to right.
 class edge{
 private:
     //The original contour passed into the function.
-    std::vector<cv::Point> contour;
+    chain_code contour;
     //Normalized contour produces a contour that has its begining at (0,0)
     //and its endpoint straight above it (0,y). This is used internally
-    //to classify the piece.
+    //to classify the piece.  The reverse normalized contour (the same, but
+    //flipped 180 degrees) is normalized_contour.back() - each point, in reverse order.
     std::vector<cv::Point2f> normalized_contour;
-    std::vector<cv::Point2f> reverse_normalized_contour;
+    std::vector<cv::Point2f> reverse_normalized_contour() const;
     double arc_length; // length of the edge contour
     double corner_distance; // straight-line distance between start and end of edge contour
     template<class T> std::vector<cv::Point2f> normalize(std::vector<T>);
@@ -38,10 +49,21 @@ public:
     std::vector<cv::Point> get_translated_contour(int,int);
     std::vector<cv::Point> get_translated_contour_reverse(int,int);
     edgeType get_type();
-    double compare(edge);
-    double compare2(edge);
-    double compare3(edge);
-    double compare3(edge, double& cscore, double& escore);
+    const std::vector<cv::Point2f>& get_normalized_contour() const;
+    double get_corner_distance() const;
+    edge_view view() const;
+    // The normalized contour resampled to 'count' points evenly spaced along its length,
+    // interpolating between the points of contours shorter than 'count'
+    std::vector<cv::Point2f> resampled_contour(uint count) const;
+    double compare(const edge&) const;
+    double compare2(const edge&) const;
+    double compare3(const edge&) const;
+    double compare3(const edge&, double& cscore, double& escore) const;
+    static double compare3(const edge_view& a, const edge_view& b, double& cscore, double& escore);
+    // Like compare3(), but first aligns a to b reversed by a few iterations of ICP (rigid rotation and
+    // translation), so edges whose corners were found slightly out of place aren't penalized for it.
+    // Never scores a pair worse than compare3() does.
+    static double compare_aligned(const edge_view& a, const edge_view& b, double& cscore, double& escore);
     std::string edge_type_to_s();
     
 };
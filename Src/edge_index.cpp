@@ -0,0 +1,88 @@
+/*
+ * edge_index.cpp
+ *
+ */
+
+#include "edge_index.h"
+
+#include <algorithm>
+
+
+// Number of points in each edge descriptor
+#define DESCRIPTOR_POINTS 32
+// Number of randomized KD-trees, and the number of leaves checked by each search
+#define INDEX_TREES 4
+#define INDEX_CHECKS 64
+
+// Descriptor of an edge: the x, y coordinates of its resampled normalized contour
+static void describe(edge& e, bool reversed, float* descriptor) {
+    std::vector<cv::Point2f> points = e.resampled_contour(DESCRIPTOR_POINTS);
+    // Degenerate edges, too short to resample, are stretched by repeating points
+    for (int k = 0; k < DESCRIPTOR_POINTS; k++) {
+        int index = (int) ((long) k * (points.size() - 1) / (DESCRIPTOR_POINTS - 1));
+        cv::Point2f p = points[index];
+        if (reversed) {
+            // Reversed normalized contours are the end point - each point, in reverse order
+            p = points.back() - points[points.size() - 1 - index];
+        }
+        descriptor[2*k] = p.x;
+        descriptor[2*k + 1] = p.y;
+    }
+}
+
+// Look up each edge of type 'query_type' among the edges of type 'indexed_type'
+static void match_types(std::vector<piece>& pieces, const std::vector<bool>& excluded, uint k,
+        edgeType query_type, edgeType indexed_type, std::vector<std::pair<int, int> >& pairs) {
+    std::vector<int> queries;
+    std::vector<int> indexed;
+    for (uint i = 0; i < excluded.size(); i++) {
+        if (excluded[i]) {
+            continue;
+        }
+        edgeType type = pieces[i/4].edges[i%4].get_type();
+        if (type == query_type) queries.push_back(i);
+        if (type == indexed_type) indexed.push_back(i);
+    }
+    if (queries.empty() || indexed.empty()) {
+        return;
+    }
+    
+    cv::Mat query_descriptors(queries.size(), 2*DESCRIPTOR_POINTS, CV_32F);
+    cv::Mat indexed_descriptors(indexed.size(), 2*DESCRIPTOR_POINTS, CV_32F);
+#pragma omp parallel for schedule(dynamic)
+    for (int q = 0; q < (int) queries.size(); q++) {
+        describe(pieces[queries[q]/4].edges[queries[q]%4], false, query_descriptors.ptr<float>(q));
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (int r = 0; r < (int) indexed.size(); r++) {
+        describe(pieces[indexed[r]/4].edges[indexed[r]%4], true, indexed_descriptors.ptr<float>(r));
+    }
+    
+    int neighbours = std::min((int) k, (int) indexed.size());
+    cv::flann::Index index(indexed_descriptors, cv::flann::KDTreeIndexParams(INDEX_TREES));
+    cv::Mat neighbour_indices;
+    cv::Mat distances;
+    index.knnSearch(query_descriptors, neighbour_indices, distances, neighbours, cv::flann::SearchParams(INDEX_CHECKS));
+    
+    for (int q = 0; q < (int) queries.size(); q++) {
+        const int* row = neighbour_indices.ptr<int>(q);
+        for (int n = 0; n < neighbours; n++) {
+            if (row[n] < 0) {
+                continue;
+            }
+            int a = queries[q];
+            int b = indexed[row[n]];
+            pairs.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+        }
+    }
+}
+
+void find_candidate_pairs(std::vector<piece>& pieces, const std::vector<bool>& excluded, uint k,
+        std::vector<std::pair<int, int> >& pairs) {
+    pairs.clear();
+    match_types(pieces, excluded, k, TAB, HOLE, pairs);
+    match_types(pieces, excluded, k, HOLE, TAB, pairs);
+    // A pair is found twice when each edge is among the other's candidates
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
@@ -0,0 +1,30 @@
+/*
+ * edge_index.h
+ *
+ * Approximate nearest neighbour retrieval of the edges likely to fit each edge, so that only those
+ * pairs need to be scored.
+ */
+
+#ifndef EDGE_INDEX_H
+#define EDGE_INDEX_H
+
+#include <vector>
+#include "compat_opencv.h"
+#include "piece.h"
+
+/** @brief Find the candidate partners of every edge.
+
+Each edge is described by its normalized contour resampled to a fixed number of points.  An edge fits
+another when its normalized contour follows the other's reversed normalized contour, so the reversed
+descriptors of the tabs and of the holes are indexed in two KD-trees (cv::flann), and each hole is looked
+up in the tab index and each tab in the hole index.  Outer edges have no partners.
+
+@param pieces The pieces, with edges numbered piece_index * 4 + edge_number
+@param excluded True for edges which need no partners (e.g. inside the seed assembly)
+@param k The number of candidates retrieved for each edge
+@param pairs The candidate pairs (edge1 <= edge2), each listed once
+*/
+void find_candidate_pairs(std::vector<piece>& pieces, const std::vector<bool>& excluded, uint k,
+        std::vector<std::pair<int, int> >& pairs);
+
+#endif /* EDGE_INDEX_H */
@@ -0,0 +1,108 @@
+/*
+ * fft_edges.cpp
+ *
+ */
+
+#include "fft_edges.h"
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+// Number of steps in each turning angle signal
+#define FFT_SAMPLES 128
+// Signals are zero padded to this size, so that the correlation doesn't wrap around
+#define FFT_SIZE (2 * FFT_SAMPLES)
+// Largest offset tried between two edges, in steps
+#define FFT_MAX_SHIFT 8
+
+// Unwrapped direction of each step of the points
+static std::vector<double> turning_angles(const std::vector<cv::Point2f>& points) {
+    std::vector<double> angles;
+    double previous = 0.0;
+    for (uint k = 1; k < points.size(); k++) {
+        cv::Point2f step = points[k] - points[k - 1];
+        double angle = std::atan2(step.y, step.x);
+        if (k > 1) {
+            while (angle - previous > M_PI) angle -= 2 * M_PI;
+            while (angle - previous < -M_PI) angle += 2 * M_PI;
+        }
+        angles.push_back(angle);
+        previous = angle;
+    }
+    return angles;
+}
+
+static void add_signal(const std::vector<double>& angles, std::vector<cv::Mat>& spectra, std::vector<std::vector<double> >& squares) {
+    cv::Mat signal = cv::Mat::zeros(1, FFT_SIZE, CV_32F);
+    std::vector<double> sums(FFT_SAMPLES + 1, 0.0);
+    for (int k = 0; k < FFT_SAMPLES && k < (int) angles.size(); k++) {
+        signal.at<float>(0, k) = (float) angles[k];
+        sums[k + 1] = sums[k] + angles[k] * angles[k];
+    }
+    for (int k = angles.size(); k < FFT_SAMPLES; k++) {
+        sums[k + 1] = sums[k];
+    }
+    cv::Mat spectrum;
+    cv::dft(signal, spectrum);
+    spectra.push_back(spectrum);
+    squares.push_back(sums);
+}
+
+fft_edges::fft_edges(std::vector<piece>& pieces) {
+    for (uint i = 0; i < pieces.size(); i++) {
+        for (int j = 0; j < 4; j++) {
+            edge& e = pieces[i].edges[j];
+            std::vector<cv::Point2f> points = e.resampled_contour(FFT_SAMPLES + 1);
+            std::vector<double> angles = turning_angles(points);
+            add_signal(angles, forward_spectra, forward_squares);
+            // The steps of a reversed normalized contour are the steps of the contour in reverse order
+            std::reverse(angles.begin(), angles.end());
+            add_signal(angles, reverse_spectra, reverse_squares);
+            lengths.push_back(points.size() > 1 ? cv::arcLength(points, false) : 0.0);
+            corner_distances.push_back(e.get_corner_distance());
+            types.push_back(e.get_type());
+        }
+    }
+}
+
+double fft_edges::compare(int edge1, int edge2) const {
+    double cscore;
+    double angle_error;
+    return compare(edge1, edge2, cscore, angle_error);
+}
+
+double fft_edges::compare(int edge1, int edge2, double& cscore, double& angle_error) const {
+    if (types[edge1] == OUTER_EDGE || types[edge2] == OUTER_EDGE || types[edge1] == types[edge2]) {
+        cscore = 0.0;
+        angle_error = DBL_MAX;
+        return DBL_MAX;
+    }
+
+    double corners_diff = corner_distances[edge1] - corner_distances[edge2];
+    cscore = corners_diff * corners_diff;
+
+    // Scratch space, reused by each thread for every pair it compares
+    static thread_local cv::Mat product;
+    static thread_local cv::Mat correlation;
+    // correlation[m] = sum over k of a[k + m] * r[k], with negative offsets m wrapped to FFT_SIZE + m
+    cv::mulSpectrums(forward_spectra[edge1], reverse_spectra[edge2], product, 0, true);
+    cv::idft(product, correlation, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+    const std::vector<double>& a_squares = forward_squares[edge1];
+    const std::vector<double>& r_squares = reverse_squares[edge2];
+    double best = DBL_MAX;
+    for (int m = -FFT_MAX_SHIFT; m <= FFT_MAX_SHIFT; m++) {
+        // The overlapping steps are a[k + m] and r[k], for k in [k_begin, k_end)
+        int k_begin = std::max(0, -m);
+        int k_end = std::min(FFT_SAMPLES, FFT_SAMPLES - m);
+        double a_sum = a_squares[k_end + m] - a_squares[k_begin + m];
+        double r_sum = r_squares[k_end] - r_squares[k_begin];
+        double cross = correlation.at<float>(0, (m + FFT_SIZE) % FFT_SIZE);
+        double mismatch = std::max(0.0, a_sum + r_sum - 2 * cross) / (k_end - k_begin);
+        best = std::min(best, mismatch);
+    }
+
+    angle_error = std::sqrt(best);
+    return cscore + angle_error * lengths[edge1];
+}
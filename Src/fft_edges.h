@@ -0,0 +1,44 @@
+/*
+ * fft_edges.h
+ *
+ * Scores pairs of edges by their turning angles, allowing the edges to slide along each other, so
+ * that pairs whose corners were found slightly out of place still score well.
+ */
+
+#ifndef FFT_EDGES_H
+#define FFT_EDGES_H
+
+#include <vector>
+#include "compat_opencv.h"
+#include "piece.h"
+
+class fft_edges {
+private:
+    // Spectra of the turning angle signals of each edge, and of each edge reversed
+    std::vector<cv::Mat> forward_spectra;
+    std::vector<cv::Mat> reverse_spectra;
+    // Prefix sums of the squares of the turning angle signals of each edge, and of each edge reversed
+    std::vector<std::vector<double> > forward_squares;
+    std::vector<std::vector<double> > reverse_squares;
+    std::vector<double> lengths;
+    std::vector<double> corner_distances;
+    std::vector<edgeType> types;
+public:
+    // Edges are numbered piece_index * 4 + edge_number.
+    fft_edges(std::vector<piece>& pieces);
+
+    /** @brief Compare two edges by their turning angles.
+
+    Each edge is resampled to a fixed number of points evenly spaced along its normalized contour, and
+    described by the unwrapped direction of each step.  The mismatch of edge1 against edge2 reversed, at every
+    offset of up to a few steps either way, is found from their cross-correlation, computed by FFT from the
+    precomputed spectra.  The score is the squared corner distance difference (as in edge::compare3()) plus the
+    RMS angle difference (in radians) at the best offset times the length of edge1.  Returns DBL_MAX for
+    impossible pairs.  Safe to call concurrently: each thread has its own scratch space.
+    */
+    double compare(int edge1, int edge2) const;
+    // The same, also returning the corner distance score and the RMS angle difference at the best offset
+    double compare(int edge1, int edge2, double& cscore, double& angle_error) const;
+};
+
+#endif /* FFT_EDGES_H */
@@ -0,0 +1,346 @@
+/*
+ * genetic_solver.cpp
+ *
+ * A population based alternative to the greedy auto_solve() strategy.
+ */
+
+#include "genetic_solver.h"
+
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cfloat>
+#include "omp.h"
+
+#include "logger.h"
+
+// Number of individuals competing for each parent slot
+#define TOURNAMENT_SIZE 3
+// Fraction of each generation copied unchanged into the next
+#define ELITE_FRACTION 0.05
+// Probability that an offspring is mutated
+#define MUTATION_RATE 0.2
+// Number of individuals in the initial population built greedily rather than at random
+#define GREEDY_SEEDS 4
+
+// Row and column offsets of the neighbouring cell on each side of a cell
+static const int side_row_offset[4] = { 0, 1, 0, -1 };
+static const int side_col_offset[4] = { -1, 0, 1, 0 };
+
+// An arrangement of pieces.  Cells hold piece indices, with indices >= the number of pieces
+// standing for empty cells, so that every individual is a permutation.  While an individual
+// is being built, unassigned cells hold -1.
+struct individual {
+    std::vector<int> piece;
+    std::vector<int> rot;
+    double fitness;
+    static bool compare(const individual& a, const individual& b) {
+        return a.fitness < b.fitness;
+    }
+};
+
+class ga_context {
+public:
+    const score_table& costs;
+    const std::vector<bool>& outer_edges;
+    int no_pieces;
+    int rows;
+    int cols;
+    double border_penalty;
+
+    ga_context(const score_table& costs, const std::vector<bool>& outer_edges, int no_pieces, int rows, int cols, double border_penalty) :
+        costs(costs), outer_edges(outer_edges), no_pieces(no_pieces), rows(rows), cols(cols), border_penalty(border_penalty) {}
+
+    int cells() const {
+        return rows * cols;
+    }
+
+    // Score of one side of the piece in the given cell.  Sides facing out of the grid are
+    // penalized unless they are outer edges; sides facing empty or unassigned cells score 0.
+    double side_cost(const individual& ind, int cell, int side) const {
+        int p = ind.piece[cell];
+        int e = p*4 + score_table::edge_at(ind.rot[cell], (gridSide) side);
+        int nrow = cell / cols + side_row_offset[side];
+        int ncol = cell % cols + side_col_offset[side];
+        if (nrow < 0 || ncol < 0 || nrow >= rows || ncol >= cols) {
+            return outer_edges[e] ? 0.0 : border_penalty;
+        }
+        int ncell = nrow * cols + ncol;
+        int q = ind.piece[ncell];
+        if (q < 0 || q >= no_pieces) {
+            return 0.0;
+        }
+        return costs.pair_score(e, q*4 + score_table::edge_at(ind.rot[ncell], (gridSide) ((side + 2) % 4)));
+    }
+
+    double cell_cost(const individual& ind, int cell) const {
+        if (ind.piece[cell] < 0 || ind.piece[cell] >= no_pieces) {
+            return 0.0;
+        }
+        double cost = 0.0;
+        for (int side = 0; side < 4; side++) {
+            cost += side_cost(ind, cell, side);
+        }
+        return cost;
+    }
+
+    // Pairs of adjacent edges are counted once (via the right and bottom sides of each cell),
+    // border penalties for every side facing out of the grid.
+    double fitness(const individual& ind) const {
+        double total = 0.0;
+        for (int cell = 0; cell < cells(); cell++) {
+            if (ind.piece[cell] >= no_pieces) {
+                continue;
+            }
+            int row = cell / cols;
+            int col = cell % cols;
+            total += side_cost(ind, cell, SIDE_RIGHT);
+            total += side_cost(ind, cell, SIDE_BOTTOM);
+            if (col == 0) total += side_cost(ind, cell, SIDE_LEFT);
+            if (row == 0) total += side_cost(ind, cell, SIDE_TOP);
+        }
+        return total;
+    }
+
+    void best_rotation(individual& ind, int cell) const {
+        int best = ind.rot[cell];
+        double best_cost = cell_cost(ind, cell);
+        for (int r = 0; r < 4; r++) {
+            ind.rot[cell] = r;
+            double cost = cell_cost(ind, cell);
+            if (cost < best_cost) {
+                best = r;
+                best_cost = cost;
+            }
+        }
+        ind.rot[cell] = best;
+    }
+
+    individual random_individual(std::mt19937& rng) const {
+        individual ind;
+        for (int cell = 0; cell < cells(); cell++) {
+            ind.piece.push_back(cell);
+            ind.rot.push_back(rng() % 4);
+        }
+        std::shuffle(ind.piece.begin(), ind.piece.end(), rng);
+        return ind;
+    }
+
+    // Fill the grid in row-major order, starting with a random piece, and placing the unused
+    // piece and rotation that best fits the neighbours already placed in each following cell.
+    individual greedy_individual(std::mt19937& rng) const {
+        individual ind;
+        ind.piece.assign(cells(), -1);
+        ind.rot.assign(cells(), 0);
+        std::vector<bool> used(no_pieces, false);
+
+        int first = rng() % no_pieces;
+        ind.piece[0] = first;
+        best_rotation(ind, 0);
+        used[first] = true;
+
+        for (int cell = 1; cell < no_pieces; cell++) {
+            int best = -1;
+            int best_rot = 0;
+            double best_cost = DBL_MAX;
+            for (int p = 0; p < no_pieces; p++) {
+                if (used[p]) continue;
+                ind.piece[cell] = p;
+                for (int r = 0; r < 4; r++) {
+                    ind.rot[cell] = r;
+                    double cost = cell_cost(ind, cell);
+                    if (cost < best_cost) {
+                        best = p;
+                        best_rot = r;
+                        best_cost = cost;
+                    }
+                }
+            }
+            ind.piece[cell] = best;
+            ind.rot[cell] = best_rot;
+            used[best] = true;
+        }
+        // Any remaining cells are empty
+        for (int cell = no_pieces; cell < cells(); cell++) {
+            ind.piece[cell] = cell;
+        }
+        return ind;
+    }
+
+    // Two dimensional partially-mapped crossover: a random window of placements is copied from b
+    // into a copy of a, by swapping each wanted piece into place.  Pieces pushed out of the window
+    // are given their best rotation at their new location.
+    individual crossover(const individual& a, const individual& b, std::mt19937& rng) const {
+        individual child = a;
+        std::vector<int> position(cells());
+        for (int cell = 0; cell < cells(); cell++) {
+            position[child.piece[cell]] = cell;
+        }
+
+        int height = 1 + rng() % rows;
+        int width = 1 + rng() % cols;
+        int top = rng() % (rows - height + 1);
+        int left = rng() % (cols - width + 1);
+
+        std::vector<int> displaced;
+        for (int row = top; row < top + height; row++) {
+            for (int col = left; col < left + width; col++) {
+                int cell = row * cols + col;
+                int wanted = b.piece[cell];
+                if (child.piece[cell] != wanted) {
+                    int other = position[wanted];
+                    std::swap(child.piece[cell], child.piece[other]);
+                    std::swap(child.rot[cell], child.rot[other]);
+                    position[child.piece[other]] = other;
+                    position[wanted] = cell;
+                    displaced.push_back(other);
+                }
+                child.rot[cell] = b.rot[cell];
+            }
+        }
+
+        for (uint k = 0; k < displaced.size(); k++) {
+            int row = displaced[k] / cols;
+            int col = displaced[k] % cols;
+            if (row < top || row >= top + height || col < left || col >= left + width) {
+                best_rotation(child, displaced[k]);
+            }
+        }
+        return child;
+    }
+
+    void mutate(individual& ind, std::mt19937& rng) const {
+        int count = 1 + rng() % 3;
+        for (int k = 0; k < count; k++) {
+            int a = rng() % cells();
+            int b = rng() % cells();
+            if (a == b) {
+                ind.rot[a] = (ind.rot[a] + 1 + rng() % 3) % 4;
+            }
+            else {
+                std::swap(ind.piece[a], ind.piece[b]);
+                best_rotation(ind, a);
+                best_rotation(ind, b);
+            }
+        }
+    }
+};
+
+// Choose the grid dimensions from the piece types.  With c = columns - 2 and r = rows - 2, a
+// rectangular puzzle has 4 corner pieces, 2(c + r) frame pieces and c * r middle pieces.
+// Returns false, after choosing a near-square grid, if the piece counts don't fit a rectangle.
+static bool grid_dimensions(const std::vector<pieceType>& piece_types, int& rows, int& cols) {
+    int corners = 0;
+    int frames = 0;
+    int middles = 0;
+    for (uint i = 0; i < piece_types.size(); i++) {
+        switch (piece_types[i]) {
+            case CORNER: corners++; break;
+            case FRAME: frames++; break;
+            case MIDDLE: middles++; break;
+        }
+    }
+
+    if (corners == 4 && frames % 2 == 0) {
+        int half = frames / 2;
+        int discriminant = half * half - 4 * middles;
+        if (discriminant >= 0) {
+            int root = (int) (std::sqrt((double) discriminant) + 0.5);
+            if (root * root == discriminant && (half + root) % 2 == 0) {
+                cols = (half + root) / 2 + 2;
+                rows = (half - root) / 2 + 2;
+                return true;
+            }
+        }
+    }
+
+    int n = piece_types.size();
+    cols = (int) std::ceil(std::sqrt((double) n));
+    rows = (n + cols - 1) / cols;
+    return false;
+}
+
+bool genetic_solve(const score_table& costs, const std::vector<pieceType>& piece_types, const std::vector<bool>& outer_edges,
+        params& user_params, const time_budget& budget, cv::Mat_<int>& locations, cv::Mat_<int>& rotations) {
+
+    int no_pieces = piece_types.size();
+    if (no_pieces < 2) {
+        return false;
+    }
+
+    int rows;
+    int cols;
+    bool exact = grid_dimensions(piece_types, rows, cols);
+    // Only insist on outer edges around the border when the grid dimensions are known to be right
+    ga_context ctx(costs, outer_edges, no_pieces, rows, cols, exact ? score_table::IMPOSSIBLE_PENALTY : 0.0);
+
+    int population_size = std::max(4, (int) user_params.getGaPopulation());
+    int generations = user_params.getGaGenerations();
+    int elite = std::max(1, (int) (population_size * ELITE_FRACTION));
+
+    logger::stream() << "Genetic solver: " << rows << "x" << cols << " grid" << (exact ? "" : " (estimated)")
+            << ", population " << population_size << ", " << generations << " generations" << std::endl;
+    logger::flush();
+
+    std::vector<individual> population(population_size);
+    std::vector<individual> offspring(population_size);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < population_size; k++) {
+        std::mt19937 rng(k + 1);
+        population[k] = (k < GREEDY_SEEDS) ? ctx.greedy_individual(rng) : ctx.random_individual(rng);
+        population[k].fitness = ctx.fitness(population[k]);
+    }
+    std::sort(population.begin(), population.end(), individual::compare);
+
+    for (int generation = 1; generation <= generations; generation++) {
+        if (budget.expired()) {
+            logger::stream() << "Time budget expired after " << (generation - 1) << " generations" << std::endl;
+            logger::flush();
+            break;
+        }
+        for (int k = 0; k < elite; k++) {
+            offspring[k] = population[k];
+        }
+
+#pragma omp parallel for schedule(dynamic)
+        for (int k = elite; k < population_size; k++) {
+            std::mt19937 rng(generation * population_size + k + 1);
+            // The population is sorted, so the lowest index drawn is the fittest contestant
+            int a = population_size;
+            int b = population_size;
+            for (int t = 0; t < TOURNAMENT_SIZE; t++) {
+                a = std::min(a, (int) (rng() % population_size));
+                b = std::min(b, (int) (rng() % population_size));
+            }
+            individual child = ctx.crossover(population[a], population[b], rng);
+            if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < MUTATION_RATE) {
+                ctx.mutate(child, rng);
+            }
+            child.fitness = ctx.fitness(child);
+            offspring[k] = child;
+        }
+
+        population.swap(offspring);
+        std::sort(population.begin(), population.end(), individual::compare);
+
+        if (user_params.isVerbose() && generation % 50 == 0) {
+            logger::stream() << "Generation " << generation << ", best fitness " << population[0].fitness << std::endl;
+            logger::flush();
+        }
+    }
+
+    individual& best = population[0];
+    logger::stream() << "Genetic solver best fitness: " << best.fitness << std::endl;
+    logger::flush();
+
+    locations = cv::Mat_<int>(rows, cols, -1);
+    rotations = cv::Mat_<int>(rows, cols, 0);
+    for (int cell = 0; cell < ctx.cells(); cell++) {
+        if (best.piece[cell] < no_pieces) {
+            locations(cell / cols, cell % cols) = best.piece[cell];
+            rotations(cell / cols, cell % cols) = best.rot[cell];
+        }
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+/*
+ * genetic_solver.h
+ *
+ */
+
+#ifndef GENETIC_SOLVER_H
+#define GENETIC_SOLVER_H
+
+#include <vector>
+#include "compat_opencv.h"
+#include "params.h"
+#include "piece.h"
+#include "score_table.h"
+#include "time_budget.h"
+
+/** @brief Solve the puzzle with a genetic algorithm.
+
+The grid dimensions are derived from the numbers of corner, frame and middle pieces.  Each individual
+places every piece (with a rotation) in the grid, and its fitness is the sum of the scores of all pairs of
+adjacent edges, plus penalties for non-outer edges on the border of the grid.  New individuals are bred
+with a two dimensional partially-mapped crossover, which copies a rectangular window of placements from
+one parent into the other while keeping every piece placed exactly once, and then mutated by swapping or
+rotating pieces.  Offspring are bred and evaluated in parallel.  Evolution stops early if the time budget
+expires.
+
+Returns true if a solution grid was produced.
+
+@param costs The edge-edge score lookup
+@param piece_types The type of each piece
+@param outer_edges True for each edge (numbered piece_index * 4 + edge_number) classified as OUTER_EDGE
+@param user_params The user params object (population size, generation count, verbose)
+@param budget The time budget for the run
+@param locations The grid of piece indices (-1 for empty cells) of the best individual found
+@param rotations The grid of piece rotations of the best individual found
+*/
+bool genetic_solve(const score_table& costs, const std::vector<pieceType>& piece_types, const std::vector<bool>& outer_edges,
+        params& user_params, const time_budget& budget, cv::Mat_<int>& locations, cv::Mat_<int>& rotations);
+
+#endif /* GENETIC_SOLVER_H */
@@ -115,13 +115,14 @@ public:
         int alignx = 0;
         int aligny = 0;
         
-        orig = color ? p.full_color : bw_to_color(p.bw);
+        cv::Mat bw = p.get_bw();
+        orig = color ? p.get_color() : bw_to_color(bw);
 
         
         // Add alpha channel and initialize it using the bw image
         cv::Mat channels[4];
         cv::split(orig, channels);
-        p.bw.convertTo(channels[3], channels[0].type());
+        bw.convertTo(channels[3], channels[0].type());
         cv::merge(channels, 4, orig);
         
         
@@ -211,10 +212,10 @@ public:
     void render() {
      
         int maxdim = std::max(std::max(std::max(
-                p1.full_color.size().width, 
-                p1.full_color.size().height), 
-                p2.full_color.size().width), 
-                p2.full_color.size().height);        
+                p1.get_size().width, 
+                p1.get_size().height), 
+                p2.get_size().width), 
+                p2.get_size().height);        
         
         int width = maxdim * 2 + margin * 4;
 
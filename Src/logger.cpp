@@ -18,17 +18,32 @@ void logger::set_filename(std::string filename) {
 }
 
 std::ostringstream& logger::_stream() {
-  return os;
+  static thread_local thread_buffer buffer;
+  return buffer.os;
+}
+
+// Thread local objects are destroyed before the logger singleton (a static), even on the main thread
+logger::thread_buffer::~thread_buffer() {
+  std::string message = os.str();
+  if (!message.empty()) {
+    get_instance().write(message);
+  }
 }
 
 void logger::_flush() {
+  std::ostringstream& os = _stream();
   std::string message = os.str();
+  os.str("");
+  os.clear();
+  write(message);
+}
+
+void logger::write(const std::string& message) {
+  std::lock_guard<std::mutex> lock(flush_mutex);
   std::cout << message << std::flush;
   if (ofstream != NULL) {
     *ofstream << message << std::flush;
   }
-  os.str("");
-  os.clear();
 }
 
 logger& logger::get_instance()
@@ -50,7 +65,6 @@ void logger::flush() {
 }
 
 logger::~logger() {
-  _flush();
   if (ofstream != NULL) {
     ofstream->close();
   }
@@ -4,17 +4,26 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <mutex>
 
+// Messages written to stream() are buffered per thread, and flush() writes the calling thread's
+// buffered messages to the console and log file as a unit, so threads may log concurrently.
 class logger
 {
 private:
-  std::ostringstream os;
+  std::mutex flush_mutex;
   std::string logfilename;
   std::ofstream* ofstream;
+  // A thread's buffered messages.  Anything still buffered when the thread exits is written out then.
+  struct thread_buffer {
+    std::ostringstream os;
+    ~thread_buffer();
+  };
   logger();
   void set_filename(std::string filename);
   std::ostringstream& _stream();
   void _flush();
+  void write(const std::string& message);
 public:
   static logger& get_instance();
   static void filename(std::string filename);
@@ -57,6 +57,17 @@ void demo_help(std::map<std::string,demo*> &demos)
     }
 }
 
+// Describes the share of the --time-budget used by a phase which took 'millis' milliseconds
+std::string budget_share(long millis, params& user_params)
+{
+    if (user_params.getTimeBudget() <= 0) {
+        return "";
+    }
+    std::stringstream share;
+    share << " (" << std::fixed << std::setprecision(1) << (millis / 10.0 / user_params.getTimeBudget()) << "% of time budget)";
+    return share.str();
+}
+
 int main(int argc, char * argv[])
 {
     params user_params;
@@ -83,16 +94,35 @@ int main(int argc, char * argv[])
       ("t,threshold", "Threshold value used when converting color images to b&w.  Min: 0, max: 255.", cxxopts::value<uint>()->default_value("30"))
       ("f,filter", "Use filter() instead of median_filter()", cxxopts::value<bool>()->default_value("false"))
       ("m,median-blur-ksize", "Median blur ksize value. Must be odd and greater than 1, e.g.: 3, 5, 7 ...", cxxopts::value<uint>()->default_value("5"))
+      ("coarse-scale", "Locate pieces in scans downsampled by this factor, then find each piece's contour at full resolution (1 to disable)", cxxopts::value<uint>()->default_value("1"))
+      ("blob-prefilter", "Reject small blobs from connected component statistics before tracing piece contours (faster on noisy scans)", cxxopts::value<bool>()->default_value("false"))
+      ("compact-storage", "Keep only the outline of each piece in memory, and crop its color image from the scan again when it is needed", cxxopts::value<bool>()->default_value("false"))
+      ("tile-size", "Preprocess each scan in parallel tiles of this many pixels square, to limit memory use on very large scans (0 to process whole scans)", cxxopts::value<uint>()->default_value("0"))
       ("r,verify-contours", "Show the contours found in each input image", cxxopts::value<bool>()->default_value("false"))
       ("i,initial-piece-id", "Identify pieces starting with this number", cxxopts::value<uint>()->default_value("1"))            
       ("o,order", "Order of pieces in the input images", cxxopts::value<std::string>()->default_value("lrtb"))
       ("p,partition", "Piece-ordering partition factor for adjusting behavior of --order", cxxopts::value<float>()->default_value("1.0"))                
       ("b,corners-blocksize", "Block size to use when finding corners", cxxopts::value<uint>()->default_value("25"))            
       ("c,corners-quality", "Corner quality warning threshold", cxxopts::value<uint>()->default_value("300"))              
+      ("corner-detector", "Corner detector: harris (Harris response of the b/w image) or contour (angles along the piece outline)", cxxopts::value<std::string>()->default_value("harris"))
       ("a,adjust-corners","Show GUI corner adjuster for each piece where its corner quality exceeds the corners quality threshold", cxxopts::value<bool>()->default_value("false"))
       ("l,scale","Scale factor for images shown in GUI windows",  cxxopts::value<float>()->default_value("1.0"))
       ("cscore-limit","Limit of cscore values auto accepted as matches", cxxopts::value<float>()->default_value("125.0"))            
       ("escore-limit","Limit of escore values auto accepted as matches", cxxopts::value<float>()->default_value("4000.0"))                        
+      ("fft-angle-limit","With --score-engine fft, limit of the RMS edge direction difference (in radians) auto accepted as matches, instead of --escore-limit", cxxopts::value<float>()->default_value("0.3"))
+      ("multi-start","In auto solve mode, run this many solver configurations concurrently and keep the best result", cxxopts::value<uint>()->default_value("1"))
+      ("refine-time","In auto solve mode, spend up to this many seconds refining the solution by simulated annealing", cxxopts::value<float>()->default_value("0"))
+      ("solver","Auto solve strategy: greedy or genetic", cxxopts::value<std::string>()->default_value("greedy"))
+      ("ga-population","Population size for the genetic solver", cxxopts::value<uint>()->default_value("200"))
+      ("ga-generations","Number of generations for the genetic solver", cxxopts::value<uint>()->default_value("1000"))
+      ("seed-assembly","File describing an already assembled region of the puzzle (rows of comma separated id:rotation cells, '-' for gaps)", cxxopts::value<std::string>()->default_value(""))
+      ("score-engine","Edge pair scoring: exact (floating point contours), quantized (faster, 16 bit fixed point contours) or fft (turning angles aligned by FFT cross-correlation, tolerates misplaced corners)", cxxopts::value<std::string>()->default_value("exact"))
+      ("validate-scores","With --score-engine quantized or fft, report the rank correlation of a sample of the scores with the exact scores", cxxopts::value<bool>()->default_value("false"))
+      ("score-tile-size","Score edge pairs in blocks of this many edges square, to keep their contours in cache (0 to score one edge at a time)", cxxopts::value<uint>()->default_value("64"))
+      ("cascade-top-k","Score edge pairs on edges simplified to 32 points first, then rescore only each edge's best K candidates at full resolution (0 to score every pair at full resolution)", cxxopts::value<uint>()->default_value("0"))
+      ("ann-candidates","Score each edge only against the K edges retrieved as its most likely partners by a nearest neighbour search of their shapes (0 to score every pair)", cxxopts::value<uint>()->default_value("0"))
+      ("refine-top-k","Rescore the K best candidate pairs of each edge after aligning the edges with ICP, and re-rank them (0 to disable)", cxxopts::value<uint>()->default_value("0"))
+      ("time-budget","Stop solving after this many seconds and keep the largest assembled group found so far (0 for no limit)", cxxopts::value<float>()->default_value("0"))
       ("save-all", "Save all images (originals, contours, b&w, color, corners, edges)", cxxopts::value<bool>()->default_value("false"))
       ("save-originals", "Save original images", cxxopts::value<bool>()->default_value("false"))                        
       ("save-contours", "Save contour images", cxxopts::value<bool>()->default_value("false"))            
@@ -182,6 +212,47 @@ int main(int argc, char * argv[])
         exit(1);
     }
 
+    std::string corner_detector = result["corner-detector"].as<std::string>();
+    if (corner_detector != "harris" && corner_detector != "contour") {
+        std::cout << "ERROR: Corner detector '" << corner_detector << "' is invalid, expected one of: harris, contour" << std::endl;
+        exit(1);
+    }
+
+    std::string solver = result["solver"].as<std::string>();
+    if (solver != "greedy" && solver != "genetic") {
+        std::cout << "ERROR: Solver '" << solver << "' is invalid, expected one of: greedy, genetic" << std::endl;
+        exit(1);
+    }
+    if (solver == "genetic" && result["seed-assembly"].as<std::string>() != "") {
+        std::cout << "ERROR: --seed-assembly can't be used with the genetic solver" << std::endl;
+        exit(1);
+    }
+
+    std::string score_engine = result["score-engine"].as<std::string>();
+    if (score_engine != "exact" && score_engine != "quantized" && score_engine != "fft") {
+        std::cout << "ERROR: Score engine '" << score_engine << "' is invalid, expected one of: exact, quantized, fft" << std::endl;
+        exit(1);
+    }
+    if (result["validate-scores"].as<bool>() && score_engine == "exact") {
+        std::cout << "ERROR: --validate-scores requires --score-engine quantized or fft" << std::endl;
+        exit(1);
+    }
+
+    if (score_engine == "fft" && result["cascade-top-k"].as<uint>() > 0) {
+        std::cout << "ERROR: --cascade-top-k can't be used with --score-engine fft" << std::endl;
+        exit(1);
+    }
+
+    if (score_engine == "fft" && result["refine-top-k"].as<uint>() > 0) {
+        std::cout << "ERROR: --refine-top-k can't be used with --score-engine fft" << std::endl;
+        exit(1);
+    }
+
+    if (result["ann-candidates"].as<uint>() > 0 && result["cascade-top-k"].as<uint>() > 0) {
+        std::cout << "ERROR: --ann-candidates and --cascade-top-k can't be used together" << std::endl;
+        exit(1);
+    }
+
     bool guided = result["guided"].as<bool>();
     user_params.setGuidedSolution(guided);
     if (guided) {
@@ -194,15 +265,34 @@ int main(int argc, char * argv[])
     user_params.setSolutionFileBasename(result["solution-name"].as<std::string>());
     user_params.setWorkOnPiece(result["work-on"].as<int>());
     user_params.setMedianBlurKSize(result["median-blur-ksize"].as<uint>());
+    user_params.setTileSize(result["tile-size"].as<uint>());
+    user_params.setCoarseScale(result["coarse-scale"].as<uint>());
+    user_params.setBlobPrefilter(result["blob-prefilter"].as<bool>());
+    user_params.setCompactStorage(result["compact-storage"].as<bool>());
     user_params.setPieceOrder(result["order"].as<std::string>());
     user_params.setInitialPieceId(result["initial-piece-id"].as<uint>());
     user_params.setPartitionFactor(result["partition"].as<float>());
     user_params.setFindCornersBlockSize(result["corners-blocksize"].as<uint>());
-    user_params.setMinCornersQuality(result["corners-quality"].as<uint>());  
+    user_params.setMinCornersQuality(result["corners-quality"].as<uint>());
+    user_params.setCornerDetector(corner_detector);  
     user_params.setAdjustingCorners(result["adjust-corners"].as<bool>());
     user_params.setGuiScale(result["scale"].as<float>());
     user_params.setCscoreLimit(result["cscore-limit"].as<float>());
-    user_params.setEscoreLimit(result["escore-limit"].as<float>());  
+    user_params.setEscoreLimit(result["escore-limit"].as<float>());
+    user_params.setFftAngleLimit(result["fft-angle-limit"].as<float>());  
+    user_params.setMultiStartCount(result["multi-start"].as<uint>());
+    user_params.setRefineTime(result["refine-time"].as<float>());
+    user_params.setSolverStrategy(solver);
+    user_params.setGaPopulation(result["ga-population"].as<uint>());
+    user_params.setGaGenerations(result["ga-generations"].as<uint>());
+    user_params.setTimeBudget(result["time-budget"].as<float>());
+    user_params.setSeedAssemblyFile(result["seed-assembly"].as<std::string>());
+    user_params.setScoreEngine(score_engine);
+    user_params.setValidateScores(result["validate-scores"].as<bool>());
+    user_params.setScoreTileSize(result["score-tile-size"].as<uint>());
+    user_params.setCascadeTopK(result["cascade-top-k"].as<uint>());
+    user_params.setAnnCandidates(result["ann-candidates"].as<uint>());
+    user_params.setRefineTopK(result["refine-top-k"].as<uint>());
     user_params.setVerifyingContours(result["verify-contours"].as<bool>());
     user_params.setSaveAll(result["save-all"].as<bool>());
     user_params.setSavingOriginals(result["save-originals"].as<bool>());    
@@ -231,7 +321,9 @@ int main(int argc, char * argv[])
     puzzle puzzle(user_params);
 
     gettimeofday(&time, NULL);
-    logger::stream() << std::endl << "time to initialize:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 << std::endl;
+    logger::stream() << std::endl << "time to initialize:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 
+            << budget_share(((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis, user_params) << std::endl;
+    logger::stream() << "peak memory after initialize:" << (utils::peak_rss_kb() / 1024) << " MB" << std::endl;
     logger::flush();
     inbetween_millis = ((time.tv_sec * 1000) + (time.tv_usec / 1000));
     
@@ -243,24 +335,29 @@ int main(int argc, char * argv[])
     logger::flush();
     puzzle.fill_costs();
     gettimeofday(&time, NULL);
-    logger::stream() << std::endl << "time to fill edge costs:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 << std::endl;
+    logger::stream() << std::endl << "time to fill edge costs:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 
+            << budget_share(((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis, user_params) << std::endl;
     logger::flush();
     inbetween_millis = ((time.tv_sec * 1000) + (time.tv_usec / 1000));
     
     puzzle.solve();
     gettimeofday(&time, NULL);
-    logger::stream() << std::endl << "time to solve:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 << std::endl;
+    logger::stream() << std::endl << "time to solve:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 
+            << budget_share(((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis, user_params) << std::endl;
     logger::flush();
     inbetween_millis = ((time.tv_sec * 1000) + (time.tv_usec / 1000));
     puzzle.save_solution_text();
     puzzle.save_solution_image();
     gettimeofday(&time, NULL);
-    logger::stream() << std::endl << "Time to draw:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 << std::endl;
+    logger::stream() << std::endl << "Time to draw:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis)/1000.0 
+            << budget_share(((time.tv_sec * 1000) + (time.tv_usec / 1000))-inbetween_millis, user_params) << std::endl;
     logger::flush();
     
     
     gettimeofday(&time, NULL);
-    logger::stream() << std::endl << "total time:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-millis)/1000.0 << std::endl;
+    logger::stream() << std::endl << "total time:"  << (((time.tv_sec * 1000) + (time.tv_usec / 1000))-millis)/1000.0 
+            << budget_share(((time.tv_sec * 1000) + (time.tv_usec / 1000))-millis, user_params) << std::endl;
+    logger::stream() << "peak memory:" << (utils::peak_rss_kb() / 1024) << " MB" << std::endl;
     logger::flush();
     
     puzzle.show_solution_image();
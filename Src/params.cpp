@@ -176,6 +176,38 @@ uint params::getMedianBlurKSize() const {
 void params::setMedianBlurKSize(uint medianBlurKSize) {
     this->medianBlurKSize = medianBlurKSize;
 }
+
+uint params::getTileSize() const {
+    return tileSize;
+}
+
+void params::setTileSize(uint tileSize) {
+    this->tileSize = tileSize;
+}
+
+uint params::getCoarseScale() const {
+    return coarseScale;
+}
+
+void params::setCoarseScale(uint coarseScale) {
+    this->coarseScale = coarseScale;
+}
+
+bool params::isBlobPrefilter() const {
+    return blobPrefilter;
+}
+
+void params::setBlobPrefilter(bool blobPrefilter) {
+    this->blobPrefilter = blobPrefilter;
+}
+
+bool params::isCompactStorage() const {
+    return compactStorage;
+}
+
+void params::setCompactStorage(bool compactStorage) {
+    this->compactStorage = compactStorage;
+}
     
 uint params::getFindCornersBlockSize() const {
     return findCornersBlockSize;
@@ -184,6 +216,14 @@ uint params::getFindCornersBlockSize() const {
 void params::setFindCornersBlockSize(uint findCornersBlockSize) {
     this->findCornersBlockSize = findCornersBlockSize;
 }
+
+std::string params::getCornerDetector() const {
+    return cornerDetector;
+}
+
+void params::setCornerDetector(std::string cornerDetector) {
+    this->cornerDetector = cornerDetector;
+}
     
 uint params::getMinCornersQuality() const {
     return minCornersQuality;
@@ -225,6 +265,118 @@ void params::setEscoreLimit(float escoreLimit) {
     this->escoreLimit = escoreLimit;
 }
 
+float params::getFftAngleLimit() const {
+    return fftAngleLimit;
+}
+
+void params::setFftAngleLimit(float fftAngleLimit) {
+    this->fftAngleLimit = fftAngleLimit;
+}
+
+uint params::getMultiStartCount() const {
+    return multiStartCount;
+}
+
+void params::setMultiStartCount(uint multiStartCount) {
+    this->multiStartCount = multiStartCount;
+}
+
+float params::getRefineTime() const {
+    return refineTime;
+}
+
+void params::setRefineTime(float refineTime) {
+    this->refineTime = refineTime;
+}
+
+std::string params::getSolverStrategy() const {
+    return solverStrategy;
+}
+
+void params::setSolverStrategy(std::string solverStrategy) {
+    this->solverStrategy = solverStrategy;
+}
+
+uint params::getGaPopulation() const {
+    return gaPopulation;
+}
+
+void params::setGaPopulation(uint gaPopulation) {
+    this->gaPopulation = gaPopulation;
+}
+
+uint params::getGaGenerations() const {
+    return gaGenerations;
+}
+
+void params::setGaGenerations(uint gaGenerations) {
+    this->gaGenerations = gaGenerations;
+}
+
+float params::getTimeBudget() const {
+    return timeBudget;
+}
+
+void params::setTimeBudget(float timeBudget) {
+    this->timeBudget = timeBudget;
+}
+
+std::string params::getSeedAssemblyFile() const {
+    return seedAssemblyFile;
+}
+
+void params::setSeedAssemblyFile(std::string seedAssemblyFile) {
+    this->seedAssemblyFile = seedAssemblyFile;
+}
+
+std::string params::getScoreEngine() const {
+    return scoreEngine;
+}
+
+void params::setScoreEngine(std::string scoreEngine) {
+    this->scoreEngine = scoreEngine;
+}
+
+bool params::isValidateScores() const {
+    return validateScores;
+}
+
+void params::setValidateScores(bool validateScores) {
+    this->validateScores = validateScores;
+}
+
+uint params::getScoreTileSize() const {
+    return scoreTileSize;
+}
+
+void params::setScoreTileSize(uint scoreTileSize) {
+    this->scoreTileSize = scoreTileSize;
+}
+
+uint params::getCascadeTopK() const {
+    return cascadeTopK;
+}
+
+void params::setCascadeTopK(uint cascadeTopK) {
+    this->cascadeTopK = cascadeTopK;
+}
+
+uint params::getAnnCandidates() const {
+    return annCandidates;
+}
+
+void params::setAnnCandidates(uint annCandidates) {
+    this->annCandidates = annCandidates;
+}
+
+uint params::getRefineTopK() const {
+    return refineTopK;
+}
+
+void params::setRefineTopK(uint refineTopK) {
+    this->refineTopK = refineTopK;
+}
+
 int params::getWorkOnPiece() const {
     return workOnPiece;
 }
@@ -259,14 +411,33 @@ std::string params::to_string() const {
     stream << "threshold .............. " << this->getThreshold() << std::endl;
     stream << "median filter .......... " << bool_to_string(this->isUsingMedianFilter()) << std::endl;
     stream << "median blur ksize ...... " << (this->getMedianBlurKSize()) << std::endl;
+    stream << "tile size .............. " << this->getTileSize() << std::endl;
+    stream << "coarse scale ........... " << this->getCoarseScale() << std::endl;
+    stream << "blob prefilter ......... " << bool_to_string(this->isBlobPrefilter()) << std::endl;
+    stream << "compact storage ........ " << bool_to_string(this->isCompactStorage()) << std::endl;
     stream << "piece order ............ " << this->getPieceOrder() << std::endl;        
     stream << "partition factor ....... " << this->getPartitionFactor() << std::endl;   
     stream << "find corners block size  " << this->getFindCornersBlockSize() << std::endl;
+    stream << "corner detector ........ " << this->getCornerDetector() << std::endl;
     stream << "min corners quality .... " << this->getMinCornersQuality() << std::endl;
     stream << "adjust corners ......... " << bool_to_string(this->isAdjustingCorners()) << std::endl;          
     stream << "gui scale .............. " << this->getGuiScale() << std::endl;   
     stream << "cscore limit ........... " << this->getCscoreLimit() << std::endl;   
     stream << "escore limit ........... " << this->getEscoreLimit() << std::endl;       
+    stream << "fft angle limit ........ " << this->getFftAngleLimit() << std::endl;
+    stream << "multi-start count ...... " << this->getMultiStartCount() << std::endl;
+    stream << "refine time ............ " << this->getRefineTime() << std::endl;
+    stream << "solver ................. " << this->getSolverStrategy() << std::endl;
+    stream << "ga population .......... " << this->getGaPopulation() << std::endl;
+    stream << "ga generations ......... " << this->getGaGenerations() << std::endl;
+    stream << "time budget ............ " << this->getTimeBudget() << std::endl;
+    stream << "seed assembly file ..... " << this->getSeedAssemblyFile() << std::endl;
+    stream << "score engine ........... " << this->getScoreEngine() << std::endl;
+    stream << "validate scores ........ " << bool_to_string(this->isValidateScores()) << std::endl;
+    stream << "score tile size ........ " << this->getScoreTileSize() << std::endl;
+    stream << "cascade top k .......... " << this->getCascadeTopK() << std::endl;
+    stream << "ann candidates ......... " << this->getAnnCandidates() << std::endl;
+    stream << "refine top k ........... " << this->getRefineTopK() << std::endl;
     stream << "verify contours ........ " << bool_to_string(this->isVerifyingContours()) << std::endl;
     stream << "save original images ... " << bool_to_string(this->isSavingOriginals()) << std::endl;
     stream << "save contour images .... " << bool_to_string(this->isSavingContours()) << std::endl;
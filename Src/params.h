@@ -23,6 +23,10 @@ private:
     uint threshold;
     bool useMedianFilter;
     uint medianBlurKSize;
+    uint tileSize;
+    uint coarseScale;
+    bool blobPrefilter;
+    bool compactStorage;
     float partitionFactor;
     uint minCornersQuality;
     bool saveAll;
@@ -34,10 +38,25 @@ private:
     bool savingEdges;
     bool savingMatches;
     uint findCornersBlockSize;
+    std::string cornerDetector;
     bool editingCorners;
     float guiScale;
     float cscoreLimit;
     float escoreLimit;
+    float fftAngleLimit;
+    uint multiStartCount;
+    float refineTime;
+    std::string solverStrategy;
+    uint gaPopulation;
+    uint gaGenerations;
+    float timeBudget;
+    std::string seedAssemblyFile;
+    std::string scoreEngine;
+    bool validateScores;
+    uint scoreTileSize;
+    uint cascadeTopK;
+    uint annCandidates;
+    uint refineTopK;
     int workOnPiece;
     bool verifyingContours;
 
@@ -96,6 +115,22 @@ public:
 
     void setMedianBlurKSize(uint medianBlurKSize);
 
+    uint getTileSize() const;
+
+    void setTileSize(uint tileSize);
+
+    uint getCoarseScale() const;
+
+    void setCoarseScale(uint coarseScale);
+
+    bool isBlobPrefilter() const;
+
+    void setBlobPrefilter(bool blobPrefilter);
+
+    bool isCompactStorage() const;
+
+    void setCompactStorage(bool compactStorage);
+
     uint getMinCornersQuality() const;
 
     void setMinCornersQuality(uint minCornersQuality);
@@ -133,6 +168,10 @@ public:
     uint getFindCornersBlockSize() const;
 
     void setFindCornersBlockSize(uint findCornersBlockSize);
+
+    std::string getCornerDetector() const;
+
+    void setCornerDetector(std::string cornerDetector);
     
     float getGuiScale() const;
 
@@ -149,6 +188,62 @@ public:
     float getEscoreLimit() const;
 
     void setEscoreLimit(float escoreLimit);
+
+    float getFftAngleLimit() const;
+
+    void setFftAngleLimit(float fftAngleLimit);
+
+    uint getMultiStartCount() const;
+
+    void setMultiStartCount(uint multiStartCount);
+
+    float getRefineTime() const;
+
+    void setRefineTime(float refineTime);
+
+    std::string getSolverStrategy() const;
+
+    void setSolverStrategy(std::string solverStrategy);
+
+    uint getGaPopulation() const;
+
+    void setGaPopulation(uint gaPopulation);
+
+    uint getGaGenerations() const;
+
+    void setGaGenerations(uint gaGenerations);
+
+    float getTimeBudget() const;
+
+    void setTimeBudget(float timeBudget);
+
+    std::string getSeedAssemblyFile() const;
+
+    void setSeedAssemblyFile(std::string seedAssemblyFile);
+
+    std::string getScoreEngine() const;
+
+    void setScoreEngine(std::string scoreEngine);
+
+    bool isValidateScores() const;
+
+    void setValidateScores(bool validateScores);
+
+    uint getScoreTileSize() const;
+
+    void setScoreTileSize(uint scoreTileSize);
+
+    uint getCascadeTopK() const;
+
+    void setCascadeTopK(uint cascadeTopK);
+
+    uint getAnnCandidates() const;
+
+    void setAnnCandidates(uint annCandidates);
+
+    uint getRefineTopK() const;
+
+    void setRefineTopK(uint refineTopK);
     
     int getWorkOnPiece() const;
 
@@ -12,6 +12,7 @@
 #include <cassert>
 #include <algorithm>
 #include <fstream>
+#include <cfloat>
 
 #include "compat_opencv.h"
 #include "edge.h"
@@ -43,11 +44,82 @@ std::vector<std::vector<cv::Point>::iterator> find_all_in(std::vector<cv::Point>
 
 
 
-piece::piece(uint piece_number, std::string id, cv::Mat color, cv::Mat black_and_white, params& _user_params) : user_params(_user_params) {
+piece::piece(uint piece_number, std::string id, cv::Mat color, cv::Mat black_and_white, std::vector<cv::Point> outline, params& _user_params) : user_params(_user_params) {
     this->piece_number = piece_number;
     this->id = id;
     this->full_color = color;
     this->bw = black_and_white;
+    this->outline = chain_code(outline);
+    this->corners_quality = 0.0;
+}
+
+piece::piece(uint piece_number, std::string id, std::string source_file, cv::Rect source_bounds, std::vector<cv::Point> outline, params& _user_params) : user_params(_user_params) {
+    this->piece_number = piece_number;
+    this->id = id;
+    this->source_file = source_file;
+    this->source_bounds = source_bounds;
+    this->outline = chain_code(outline);
+    this->corners_quality = 0.0;
+}
+
+// The last source image read by get_color() on each thread.  Pieces are mostly needed in the order they
+// were extracted, so this saves reading an image for each piece.  Each thread has its own, so that threads
+// working on pieces from different images don't keep evicting each other's image.
+static thread_local std::string source_image_file;
+static thread_local cv::Mat source_image;
+
+cv::Mat piece::get_color() {
+    if (source_file.empty()) {
+        return full_color;
+    }
+    if (source_image_file != source_file) {
+        source_image = cv::imread(source_file);
+        source_image_file = source_file;
+    }
+    if (source_image.data == NULL) {
+        logger::stream() << "Failed to read " << source_file << std::endl; logger::flush();
+        return cv::Mat::zeros(get_size(), CV_8UC3);
+    }
+    return crop_color(source_image, source_bounds);
+}
+
+cv::Mat piece::get_bw() {
+    if (source_file.empty()) {
+        return bw;
+    }
+    return outline_mask(outline.decode(), get_size());
+}
+
+cv::Size piece::get_size() {
+    if (source_file.empty()) {
+        return bw.size();
+    }
+    return cv::Size(source_bounds.width + 2*PIECE_BORDER_SIZE, source_bounds.height + 2*PIECE_BORDER_SIZE);
+}
+
+std::string piece::get_source_file() {
+    return source_file;
+}
+
+cv::Mat piece::crop_color(const cv::Mat& image, cv::Rect bounds) {
+    cv::Rect b2(bounds.x-3, bounds.y-3, bounds.width+6, bounds.height+6);
+    cv::Mat color_roi = image(b2);
+    cv::Mat mini_color = cv::Mat::zeros(bounds.height+2*PIECE_BORDER_SIZE,bounds.width+2*PIECE_BORDER_SIZE,CV_8UC3);
+    color_roi.copyTo(mini_color(cv::Rect(PIECE_BORDER_SIZE-3,PIECE_BORDER_SIZE-3,b2.width,b2.height)));
+    return mini_color;
+}
+
+cv::Mat piece::outline_mask(const std::vector<cv::Point>& outline, cv::Size size) {
+    cv::Mat mask = cv::Mat::zeros(size.height, size.width, CV_8UC1);
+    std::vector<std::vector<cv::Point> > contours_to_draw;
+    contours_to_draw.push_back(outline);
+    cv::drawContours(mask, contours_to_draw, -1, cv::Scalar(255), COMPAT_CV_FILLED);
+    return mask;
+}
+
+void piece::release_source_image() {
+    source_image.release();
+    source_image_file.clear();
 }
 
 uint piece::get_number() {
@@ -58,10 +130,21 @@ std::string piece::get_id() {
     return id;
 }
 
-void piece::process(){
-    find_corners();
-    extract_edges();
-    classify();
+int piece::process_edges(){
+    // Debug output, this will mark the corners with a red circle and save the image
+    if (user_params.isSavingCorners()) {
+        save_corners_image();
+    }
+    
+    if (corners.size() < 4) {
+        logger::stream() << "Only found " << corners.size() << " corners for piece " << id << std::endl; logger::flush();
+        return 2;
+    }
+    int status = extract_edges();
+    if (status == 0) {
+        status = classify();
+    }
+    return status;
 }
 
 
@@ -181,7 +264,7 @@ bool piece::load_corners_points() {
 }
 
 void piece::save_corners_image() {
-    cv::Mat corners_img = full_color.clone();
+    cv::Mat corners_img = get_color().clone();
     for(uint i = 0; i < corners.size(); i++ ) {
         circle( corners_img, corners[i], corners_img.size().width / 50, cv::Scalar(0,0,255), 2, 8, 0 );
     }
@@ -190,14 +273,153 @@ void piece::save_corners_image() {
     cv::imwrite(out_file_name.str(), corners_img);    
 }
 
+// A local maximum of the Harris corner response
+struct harris_candidate {
+    float response;
+    int index; // row-major pixel index, used to break ties
+    cv::Point point;
+    static bool compare(const harris_candidate& a, const harris_candidate& b) {
+        return (a.response != b.response) ? a.response > b.response : a.index > b.index;
+    }
+};
+
+// Finds up to 'count' corners in the same way as goodFeaturesToTrack() with the Harris detector, but
+// computes the response map only once.  goodFeaturesToTrack() keeps the local maxima whose response is
+// above qualityLevel * the largest response, and greedily accepts them, strongest first, unless they are
+// within minDistance of an accepted corner.  Lowering qualityLevel only appends weaker candidates to the
+// list, so the corners found at any qualityLevel that yields exactly 'count' corners are the first 'count'
+// corners greedily accepted from the full list of local maxima.
+static void find_harris_corners(cv::Mat& bw, int blockSize, double k, double minDistance, uint count, std::vector<cv::Point2f>& corners) {
+    cv::Mat response;
+    cv::cornerHarris(bw, response, blockSize, 3, k);
+    cv::Mat dilated;
+    cv::dilate(response, dilated, cv::Mat());
+    
+    // Like goodFeaturesToTrack(), ignore the one pixel border
+    std::vector<harris_candidate> candidates;
+    for (int y = 1; y < response.rows - 1; y++) {
+        const float* r = response.ptr<float>(y);
+        const float* d = dilated.ptr<float>(y);
+        for (int x = 1; x < response.cols - 1; x++) {
+            if (r[x] > 0 && r[x] == d[x]) {
+                harris_candidate c;
+                c.response = r[x];
+                c.index = y * response.cols + x;
+                c.point = cv::Point(x, y);
+                candidates.push_back(c);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), harris_candidate::compare);
+    
+    corners.clear();
+    for (uint i = 0; i < candidates.size() && corners.size() < count; i++) {
+        bool good = true;
+        for (uint j = 0; j < corners.size() && good; j++) {
+            double dx = candidates[i].point.x - corners[j].x;
+            double dy = candidates[i].point.y - corners[j].y;
+            good = (dx*dx + dy*dy) >= minDistance * minDistance;
+        }
+        if (good) {
+            corners.push_back(cv::Point2f((float) candidates[i].point.x, (float) candidates[i].point.y));
+        }
+    }
+}
+
+// Number of sharpest contour points considered as possible corners by find_contour_corners()
+#define CONTOUR_CORNER_CANDIDATES 12
+// Contour points with a larger angle (in degrees) are not considered to be possible corners
+#define CONTOUR_CORNER_MAX_ANGLE 150.0
+
+// Finds the corners directly from the piece outline, without any image processing.  The sharpness of
+// the outline at each point is the angle between the points k steps before and after it.  The sharpest
+// convex local minima are candidates, and the combination of four candidates (at least minDistance apart)
+// which is most like a rectangle, according to compute_corners_quality(), is chosen.
+static void find_contour_corners(const std::vector<cv::Point>& contour, double minDistance, std::vector<cv::Point2f>& corners) {
+    corners.clear();
+    int n = contour.size();
+    int k = std::max(3, n / 80);
+    if (n < 2*k + 1) {
+        return;
+    }
+    
+    std::vector<double> angle(n);
+    for (int i = 0; i < n; i++) {
+        angle[i] = utils::compute_angle<int>(contour[(i - k + n) % n], contour[i], contour[(i + k) % n]);
+    }
+    
+    std::vector<std::pair<double, int> > candidates;
+    for (int i = 0; i < n; i++) {
+        if (!(angle[i] < CONTOUR_CORNER_MAX_ANGLE)) {
+            continue;
+        }
+        // Keep only the first point of a run of equally sharp points
+        bool minimum = true;
+        for (int j = -k; j <= k && minimum; j++) {
+            double other = angle[(i + j + n) % n];
+            minimum = (j < 0) ? angle[i] < other : (j == 0 || angle[i] <= other);
+        }
+        if (!minimum) {
+            continue;
+        }
+        // Corners are convex: the chord across the corner lies inside the piece
+        cv::Point2f chord_middle = (cv::Point2f(contour[(i - k + n) % n]) + cv::Point2f(contour[(i + k) % n])) * 0.5f;
+        if (cv::pointPolygonTest(contour, chord_middle, false) < 0) {
+            continue;
+        }
+        candidates.push_back(std::make_pair(angle[i], i));
+    }
+    std::sort(candidates.begin(), candidates.end());
+    if (candidates.size() > CONTOUR_CORNER_CANDIDATES) {
+        candidates.resize(CONTOUR_CORNER_CANDIDATES);
+    }
+    
+    std::vector<cv::Point2f> points;
+    for (uint i = 0; i < candidates.size(); i++) {
+        points.push_back(cv::Point2f(contour[candidates[i].second]));
+    }
+    if (points.size() < 4) {
+        corners = points;
+        return;
+    }
+    
+    double best_quality = DBL_MAX;
+    int m = points.size();
+    for (int a = 0; a < m; a++) {
+        for (int b = a+1; b < m; b++) {
+            for (int c = b+1; c < m; c++) {
+                for (int d = c+1; d < m; d++) {
+                    std::vector<cv::Point2f> combination;
+                    combination.push_back(points[a]);
+                    combination.push_back(points[b]);
+                    combination.push_back(points[c]);
+                    combination.push_back(points[d]);
+                    bool spaced = true;
+                    for (int i = 0; i < 4 && spaced; i++) {
+                        for (int j = i+1; j < 4 && spaced; j++) {
+                            spaced = utils::distance<float>(combination[i], combination[j]) >= minDistance;
+                        }
+                    }
+                    if (!spaced) {
+                        continue;
+                    }
+                    double quality = compute_corners_quality<float>(combination);
+                    if (quality < best_quality) {
+                        best_quality = quality;
+                        corners = combination;
+                    }
+                }
+            }
+        }
+    }
+}
+
 //Gets the piece ready to use.
 //This code has been adapted from http://docs.opencv.org/doc/tutorials/features2d/trackingmotion/corner_subpixeles/corner_subpixeles.html
 void piece::find_corners(){
     
+    corners_quality = 0.0;
     if (load_corners_points()) {
-        if (user_params.isSavingCorners()) {
-            save_corners_image();
-        }
         return;
     }
     
@@ -205,40 +427,17 @@ void piece::find_corners(){
     double minDistance = user_params.getEstimatedPieceSize();
     //How big of an area to look for the corner in.
     int blockSize = user_params.getFindCornersBlockSize();
-    bool useHarrisDetector = true;
     double k = 0.04;
 
-    double min =0;
-    double max =1;
-    int max_iterations = 100;
-    bool found_all_corners = false;
-
-    //Binary search, altering quality until exactly 4 corners are found.
-    //Usually done in 1 or 2 iterations
-    while(0<max_iterations--){
-        corners.clear();
-        double qualityLevel = (min+max)/2;
-        cv::goodFeaturesToTrack(bw.clone(),
-                corners,
-                100,
-                qualityLevel,
-                minDistance,
-                cv::Mat(),
-                blockSize,
-                useHarrisDetector,
-                k);
-        if(corners.size() > 4){
-            //Found too many corners increase quality
-            min = qualityLevel;
-        } else if (corners.size() < 4){
-            max = qualityLevel;
-        } else {
-            //found all corners
-            found_all_corners = true;
-            break;
-        }
-
+    if (user_params.getCornerDetector() == "contour") {
+        // The corners are already on the outline, so there is no sub-pixel refinement
+        find_contour_corners(outline.decode(), minDistance, corners);
+        corners_quality = compute_corners_quality<float>(corners);
+        return;
     }
+    
+    cv::Mat bw = get_bw();
+    find_harris_corners(bw, blockSize, k, minDistance, 4, corners);
 
     //Find the sub-pixel locations of the corners.
     cv::Size winSize = cv::Size( blockSize, blockSize );
@@ -248,50 +447,38 @@ void piece::find_corners(){
     /// Calculate the refined corner locations
     cv::cornerSubPix( bw, corners, winSize, zeroZone, criteria );
     
-    double cornersQuality = compute_corners_quality<float>(corners);
-    if (cornersQuality > user_params.getMinCornersQuality()) {
-        logger::stream() << "Warning: poor corners for piece " << id << ", quality: " << cornersQuality << std::endl; logger::flush();
+    corners_quality = compute_corners_quality<float>(corners);
+}
+
+// Warns about poorly located corners, and lets the user adjust them if --adjust-corners is set.
+// Corners loaded from a previously saved adjustment are not reviewed again.
+void piece::review_corners(){
+    if (corners_quality > user_params.getMinCornersQuality()) {
+        logger::stream() << "Warning: poor corners for piece " << id << ", quality: " << corners_quality << std::endl; logger::flush();
         
         if (user_params.isAdjustingCorners()) {
             std::vector<cv::Point2f> edited_corners;
-            if (adjust_corners(id, full_color, user_params.getGuiScale(), corners, edited_corners, user_params.isVerbose())) {
+            cv::Mat color = get_color();
+            if (adjust_corners(id, color, user_params.getGuiScale(), corners, edited_corners, user_params.isVerbose())) {
                 corners = edited_corners;
-                cornersQuality = compute_corners_quality<float>(corners);
-                logger::stream() << "New corner quality for piece " << id << ", quality: " << cornersQuality << std::endl; logger::flush();
+                corners_quality = compute_corners_quality<float>(corners);
+                logger::stream() << "New corner quality for piece " << id << ", quality: " << corners_quality << std::endl; logger::flush();
                 save_corners_points();
             }
         }
     }
-    
-    // More debug stuff, this will mark the corners with a red circle and save the image
-    if (user_params.isSavingCorners() /* || user_params.getMinCornersQuality() < cornersQuality */) {
-        save_corners_image();
-    }
-    
-
-    if (corners.size() < 4) {
-        logger::stream() << "Only found " << corners.size() << " corners for piece " << id << std::endl; logger::flush();
-        exit(2);
-    }
 }
 
 
-void piece::extract_edges(){
-    //Extract the contour,
-    //TODO: probably should have this passed in from the puzzle, since it already does this
-    //It was done this way b/c the contours don't correspond to the correct pixel locations
-    //in this cropped version of the image.
-    std::vector<std::vector<cv::Point> > contours;
-    std::vector<cv::Vec4i> hierarchy;
-    cv::findContours(bw.clone(), contours, hierarchy, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+int piece::extract_edges(){
+    //The outline was found (and had its duplicate points removed) by the puzzle, and has been
+    //translated into the coordinates of this cropped version of the image.
     assert(corners.size() == 4);
-    if( 1 != contours.size() ){
-        logger::stream() << "Found incorrect number of contours (" << contours.size() << ") for piece" << id << std::endl; logger::flush();
-        exit(3);
+    if( outline.empty() ){
+        logger::stream() << "Missing contour for piece" << id << std::endl; logger::flush();
+        return 3;
     }
-    std::vector<cv::Point> contour = contours[0];
-
-    contour = utils::remove_duplicates(contour);
+    std::vector<cv::Point> contour = outline.decode();
 
     //out of all of the found corners, find the closest points in the contour,
     //these will become the endpoints of the edges
@@ -335,8 +522,7 @@ void piece::extract_edges(){
     edges[2] = edge(std::vector<cv::Point>(sections[2],sections[3]));
     edges[3] = edge(std::vector<cv::Point>(sections[3],contour.end()));
 
-   
-    
+    return 0;
 }
 
 
@@ -346,7 +532,7 @@ void piece::extract_edges(){
 
 
 //Classify the type of piece
-void piece::classify(){
+int piece::classify(){
     int count = 0;
     for(int i = 0; i<4; i++){
         if(edges[i].get_type() == OUTER_EDGE) count ++;
@@ -359,8 +545,9 @@ void piece::classify(){
         type = CORNER;
     } else {
         logger::stream() << "Problem, found too many outer edges for piece" << id << std:: endl; logger::flush();
-        exit(4);
+        return 4;
     }
+    return 0;
 }
 
 pieceType piece::get_type(){
@@ -17,6 +17,9 @@
 
 enum pieceType {CORNER, FRAME, MIDDLE};
 
+// Pieces are cropped from their images with this many pixels of border around the outline
+#define PIECE_BORDER_SIZE 15
+
 
 //The paradigm for the piece is that there are 4 edges
 //the edge "numbers" go from 0-3 in counter clockwise order
@@ -29,22 +32,44 @@ private:
     uint piece_number;
     std::string id;
     std::vector<cv::Point2f> corners;
+    chain_code outline; // the piece contour, in the coordinates of full_color and bw
     pieceType type;
+    double corners_quality;
 
-    void find_corners();
-    void extract_edges();
-    void classify();
+    int extract_edges();
+    int classify();
     params& user_params;
     std::string corners_points_filename();
     void save_corners_points();
     bool load_corners_points();
     void save_corners_image();
+    cv::Mat full_color; // empty with compact storage
+    cv::Mat bw; // empty with compact storage
+    std::string source_file; // with compact storage, the image the piece is cropped from
+    cv::Rect source_bounds; // with compact storage, the bounds of the outline in that image
 public:
-    cv::Mat full_color;
-    cv::Mat bw;
     edge edges[4];
-    piece(uint piece_number, std::string id, cv::Mat color, cv::Mat bw, params& user_params);
-    void process();    
+    piece(uint piece_number, std::string id, cv::Mat color, cv::Mat bw, std::vector<cv::Point> outline, params& user_params);
+    // A piece in compact storage: only the outline is kept, the color image is cropped from the source
+    // image again whenever it is needed, and the b/w image is redrawn from the outline.
+    piece(uint piece_number, std::string id, std::string source_file, cv::Rect source_bounds, std::vector<cv::Point> outline, params& user_params);
+    cv::Mat get_color();
+    cv::Mat get_bw();
+    cv::Size get_size();
+    std::string get_source_file();
+    // Crops the color image of the piece whose outline has the given bounds in image
+    static cv::Mat crop_color(const cv::Mat& image, cv::Rect bounds);
+    // Draws the b/w image of the piece with the given outline
+    static cv::Mat outline_mask(const std::vector<cv::Point>& outline, cv::Size size);
+    // Releases the source image cached by get_color() on the calling thread
+    static void release_source_image();
+    // Piece processing happens in three steps.  find_corners() and process_edges() may run concurrently
+    // for different pieces, but review_corners() may open the interactive corner editor, so the pieces
+    // must be reviewed one at a time, after all corners are found.
+    void find_corners();
+    void review_corners();
+    // Returns 0 on success, otherwise a non-zero error code (the error is logged)
+    int process_edges();
     uint get_number();
     std::string get_id();
     pieceType get_type();
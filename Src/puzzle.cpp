@@ -16,6 +16,7 @@
 #include <fstream>
 #include <iomanip>
 #include <stdio.h>
+#include <random>
 #include "omp.h"
 #include "compat_opencv.h"
 
@@ -25,9 +26,33 @@
 #include "logger.h"
 #include "guided_match.h"
 #include "image_viewer.h"
+#include "anneal.h"
+#include "genetic_solver.h"
+#include "alloc_counter.h"
+#include "quantized_edges.h"
+#include "fft_edges.h"
+#include "edge_index.h"
 
 typedef std::vector<cv::Mat> imlist;
 
+// Entries of the sorted 'matches' list whose scores are within this fraction of each other are
+// treated as ties, which a multi-start solver configuration may try in a shuffled order.
+#define TIE_TOLERANCE 0.01
+
+// Scale factors applied to --cscore-limit and --escore-limit by successive multi-start configurations.
+static const float multi_start_limit_scales[] = { 1.0f, 0.75f, 1.5f, 0.5f, 2.0f };
+#define MULTI_START_LIMIT_SCALES (sizeof(multi_start_limit_scales) / sizeof(multi_start_limit_scales[0]))
+
+// Number of points each edge is resampled to for the first stage of the --cascade-top-k scoring cascade
+#define CASCADE_POINTS 32
+
+// Fraction of --time-budget after which fill_costs() stops scoring pairs, so that the rest is left
+// for the solver
+#define SCORING_BUDGET_SHARE 0.8
+
+// Maximum number of pairs rescored exactly by --validate-scores
+#define SCORE_VALIDATION_SAMPLES 20000
+
 /*
                    _________      _____
                    \        \    /    /
@@ -43,8 +68,13 @@ typedef std::vector<cv::Mat> imlist;
 
 
 puzzle::puzzle(params& _user_params) : user_params(_user_params) {
+    budget.start(user_params.getTimeBudget());
     pieces = extract_pieces();
     solved = false;
+    scoring_complete = true;
+    seed_piece = -1;
+    quantized = NULL;
+    fft = NULL;
     if (user_params.isSavingEdges()) {
     	print_edges();
     }
@@ -52,6 +82,11 @@ puzzle::puzzle(params& _user_params) : user_params(_user_params) {
     logger::flush();
 }
 
+puzzle::~puzzle() {
+    delete quantized;
+    delete fft;
+}
+
 
 
 
@@ -77,205 +112,803 @@ void puzzle::print_edges(){
 }
 
 
+// Images are processed in batches of one per thread, so that only a bounded number of full size
+// images (and their b/w versions) are held in memory at once.  Each batch is decoded and thresholded
+// in parallel, then its pieces are cropped out in image order, after which the batch is released.
 std::vector<piece> puzzle::extract_pieces() {
     std::vector<piece> pieces;
-    imlist color_images = utils::getImages(user_params.getInputDir());
+    std::vector<std::string> filenames = utils::getImageFilenames(user_params.getInputDir());
 
     logger::stream() << "Extracting pieces..." << std::endl;    
     logger::flush();
     
-    //Threshold the image, anything of intensity greater than the threshold becomes white (255)
-    //anything below becomes 0
-//    imlist blured_images = blur(color_images, 7, 5);
-
-    imlist bw;
-    if(user_params.isUsingMedianFilter()){
-        imlist blured_images = utils::median_blur(color_images, user_params.getMedianBlurKSize());
-        bw = utils::color_to_bw(blured_images, user_params.getThreshold());
-    } else{
-        bw= utils::color_to_bw(color_images, user_params.getThreshold());
-        utils::filter(bw,2);
-    }
-
     uint piece_number = user_params.getInitialPieceId();
+    uint image_count = 0;
+    uint batch_size = omp_get_max_threads();
     
-
-    //For each input image
-    for(uint i = 0; i < color_images.size(); i++){
-
-        char image_number_buf[80];
-        sprintf(image_number_buf, "%03d", i+1);
-        std::string image_number(image_number_buf);
+    for (uint start = 0; start < filenames.size(); start += batch_size) {
+        uint end = std::min((uint) filenames.size(), start + batch_size);
+        imlist color_images(end - start);
+        imlist bw(end - start);
         
-        if (user_params.isSavingOriginals()) {
-            utils::write_debug_img(user_params, bw[i],"original-bw", image_number);
-            utils::write_debug_img(user_params, color_images[i], "original-color", image_number);
+#pragma omp parallel for schedule(dynamic)
+        for (uint k = start; k < end; k++) {
+            color_images[k - start] = cv::imread(filenames[k]);
+            if (color_images[k - start].data == NULL) {
+                continue;
+            }
+            
+            //Threshold the image, anything of intensity greater than the threshold becomes white (255)
+            //anything below becomes 0
+            if (user_params.getCoarseScale() > 1) {
+                // Only the pieces' locations are needed from the downsampled image
+                int scale = user_params.getCoarseScale();
+                cv::Mat coarse;
+                cv::resize(color_images[k - start], coarse, cv::Size(), 1.0 / scale, 1.0 / scale, cv::INTER_AREA);
+                int ksize = std::max(3, (int) (user_params.getMedianBlurKSize() / scale) | 1);
+                bw[k - start] = utils::preprocess(coarse, user_params.getThreshold(), user_params.isUsingMedianFilter(), ksize);
+            }
+            else if (user_params.getTileSize() == 0) {
+                bw[k - start] = utils::preprocess(color_images[k - start], user_params.getThreshold(), 
+                        user_params.isUsingMedianFilter(), user_params.getMedianBlurKSize());
+            }
+        }
+        
+        for (uint k = start; k < end; k++) {
+            if (color_images[k - start].data == NULL) {
+                continue;
+            }
+            if (user_params.getCoarseScale() <= 1 && user_params.getTileSize() > 0) {
+                // The tiles of each image are processed in parallel
+                bw[k - start] = utils::preprocess_tiled(color_images[k - start], user_params.getThreshold(), 
+                        user_params.isUsingMedianFilter(), user_params.getMedianBlurKSize(), user_params.getTileSize());
+            }
+            image_count += 1;
+            logger::stream() << "Loaded " << filenames[k] << " as image " << std::setfill('0') << std::setw(3) << image_count << std::endl;
+            logger::flush();
+            extract_image_pieces(image_count - 1, filenames[k], color_images[k - start], bw[k - start], piece_number, pieces);
         }
+    }
+    
+    process_pieces(pieces);
+
+    return pieces;
+}
 
-        std::vector<std::vector<cv::Point> > found_contours;
+// Finds the corners and edges of every piece.  The pieces are processed in parallel, apart from the
+// corner review (which may open the interactive corner editor) which is done for one piece at a time.
+// Rather than exiting at the first bad piece, all failures are reported before exiting.
+void puzzle::process_pieces(std::vector<piece>& pieces) {
+    int count = pieces.size();
+    
+    double start = omp_get_wtime();
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < count; i++) {
+        pieces[i].find_corners();
+    }
+    logger::stream() << "Found corners of " << count << " pieces with the " << user_params.getCornerDetector() 
+            << " corner detector in " << (omp_get_wtime() - start) << " seconds" << std::endl;
+    logger::flush();
+    
+    for (int i = 0; i < count; i++) {
+        pieces[i].review_corners();
+    }
+    
+    std::vector<int> status(count, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < count; i++) {
+        status[i] = pieces[i].process_edges();
+    }
+    // With --compact-storage and --save-corners, each thread may still hold a source image
+#pragma omp parallel
+{
+    piece::release_source_image();
+}
+    
+    int failures = 0;
+    int exit_status = 0;
+    for (int i = 0; i < count; i++) {
+        if (status[i] != 0) {
+            failures++;
+            if (exit_status == 0) {
+                exit_status = status[i];
+            }
+        }
+    }
+    if (failures > 0) {
+        logger::stream() << "Failed to process " << failures << " of " << count << " pieces" << std::endl;
+        logger::flush();
+        exit(exit_status);
+    }
+}
 
+// Finds the piece contours of an image in two steps.  The pieces are located in the b/w version of the
+// image downsampled by --coarse-scale (coarse_bw), and then only the area around each piece is converted
+// to b/w at full resolution to find its contour.
+void puzzle::find_contours_coarse(cv::Mat& color_image, cv::Mat& coarse_bw, contour_mgr& contour_mgr) {
+    int scale = user_params.getCoarseScale();
+    int margin = 2 * scale;
+    
+    // The smallest coarse size which scales up to at least the estimated piece size
+    int coarse_min_size = (user_params.getEstimatedPieceSize() + scale - 1) / scale;
+    std::vector<std::vector<cv::Point> > coarse_contours = utils::find_contours(coarse_bw, coarse_min_size, 
+            user_params.isBlobPrefilter());
+    
+    for (uint j = 0; j < coarse_contours.size(); j++) {
+        cv::Rect coarse_bounds = cv::boundingRect(coarse_contours[j]);
+        cv::Rect roi(coarse_bounds.x * scale - margin, coarse_bounds.y * scale - margin, 
+                coarse_bounds.width * scale + 2*margin, coarse_bounds.height * scale + 2*margin);
+        roi &= cv::Rect(0, 0, color_image.cols, color_image.rows);
+        cv::Mat roi_bw = utils::preprocess_region(color_image, roi, user_params.getThreshold(), 
+                user_params.isUsingMedianFilter(), user_params.getMedianBlurKSize());
         
-        //This isn't used but the opencv function wants it anyways.
-        std::vector<cv::Vec4i> hierarchy;
+        // The piece is the largest contour in the area; anything else is noise or part of a neighbour
+        std::vector<std::vector<cv::Point> > found_contours = utils::find_contours(roi_bw, 
+                user_params.getEstimatedPieceSize(), user_params.isBlobPrefilter(), roi.tl());
+        int best = -1;
+        int best_area = 0;
+        for (uint k = 0; k < found_contours.size(); k++) {
+            cv::Rect bounds = cv::boundingRect(found_contours[k]);
+            if (bounds.area() > best_area) {
+                best = k;
+                best_area = bounds.area();
+            }
+        }
+        if (best != -1) {
+            contour_mgr.add_contour(cv::boundingRect(found_contours[best]), utils::remove_duplicates(found_contours[best]));
+        }
+    }
+}
 
-        //Need to clone b/c it will get modified
-        cv::findContours(bw[i].clone(), found_contours, hierarchy, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+// Crops the pieces out of one input image, numbering them from piece_number (which is advanced past them).
+// i is the zero based index of the image, which was read from filename.  With --coarse-scale, bw_image is the b/w version of the 
+// downsampled image.
+void puzzle::extract_image_pieces(uint i, const std::string& filename, cv::Mat& color_image, cv::Mat& bw_image, uint& piece_number, std::vector<piece>& pieces) {
 
-        
- 
-        //For each contour in that image
-        //TODO: (In anticipation of the other TODO's Re-create the b/w image
-        //    based off of the contour to eliminate noise in the layer mask
+    char image_number_buf[80];
+    sprintf(image_number_buf, "%03d", i+1);
+    std::string image_number(image_number_buf);
+    
+    if (user_params.isSavingOriginals()) {
+        utils::write_debug_img(user_params, bw_image,"original-bw", image_number);
+        utils::write_debug_img(user_params, color_image, "original-color", image_number);
+    }
+
+    // Find the piece contours and number them by their position in the image.  Each piece keeps its contour,
+    // from which its b/w mask is drawn, so noise inside the piece never reaches the mask.
+    contour_mgr contour_mgr(color_image.size().width, color_image.size().height, user_params); 
 
-        contour_mgr contour_mgr(bw[i].size().width, bw[i].size().height, user_params); 
+    if (user_params.getCoarseScale() > 1) {
+        find_contours_coarse(color_image, bw_image, contour_mgr);
+    }
+    else {
+        std::vector<std::vector<cv::Point> > found_contours = utils::find_contours(bw_image, 
+                user_params.getEstimatedPieceSize(), user_params.isBlobPrefilter());
 
         for(uint j = 0; j < found_contours.size(); j++) {
-            cv::Rect bounds =  cv::boundingRect(found_contours[j]);
-            if(bounds.width < user_params.getEstimatedPieceSize() || bounds.height < user_params.getEstimatedPieceSize()) continue;
-            
-            contour_mgr.add_contour(bounds, utils::remove_duplicates(found_contours[j]));
+            contour_mgr.add_contour(cv::boundingRect(found_contours[j]), utils::remove_duplicates(found_contours[j]));
+        }
+    }
+
+    contour_mgr.sort_contours();
+    
+    if (user_params.isVerifyingContours() || user_params.isSavingContours()) {
+        std::vector<std::vector<cv::Point> > contours_to_draw;
+        cv::Mat cmat = cv::Mat::zeros(color_image.size().height, color_image.size().width, CV_8UC3);    
+        double font_scale = sqrt(color_image.size().height * color_image.size().width) / 1000;
+        for (uint j = 0; j < contour_mgr.contours.size(); j++) {
+            cv::Rect bounds = contour_mgr.contours[j].bounds;
+            contours_to_draw.push_back(contour_mgr.contours[j].points);
+            // Text indicating contour order within the image
+            cv::putText(cmat, std::to_string(j+piece_number), cv::Point2f(bounds.x+bounds.width/2-(10.0*font_scale),bounds.y+bounds.height/2+(10.0*font_scale)),
+                    cv::FONT_HERSHEY_COMPLEX_SMALL, font_scale, cv::Scalar(0, 255, 255), 1, COMPAT_CV_LINE_AA);                
         }
 
-        contour_mgr.sort_contours();
+        cv::drawContours(cmat, contours_to_draw, -1, cv::Scalar(255,255,255), 2, 16);
         
-        if (user_params.isVerifyingContours() || user_params.isSavingContours()) {
-            std::vector<std::vector<cv::Point> > contours_to_draw;
-            cv::Mat cmat = cv::Mat::zeros(bw[i].size().height, bw[i].size().width, CV_8UC3);    
-            double font_scale = sqrt(bw[i].size().height * bw[i].size().width) / 1000;
-            for (uint j = 0; j < contour_mgr.contours.size(); j++) {
-                cv::Rect bounds = contour_mgr.contours[j].bounds;
-                contours_to_draw.push_back(contour_mgr.contours[j].points);
-                // Text indicating contour order within the image
-                cv::putText(cmat, std::to_string(j+piece_number), cv::Point2f(bounds.x+bounds.width/2-(10.0*font_scale),bounds.y+bounds.height/2+(10.0*font_scale)),
-                        cv::FONT_HERSHEY_COMPLEX_SMALL, font_scale, cv::Scalar(0, 255, 255), 1, COMPAT_CV_LINE_AA);                
-            }
-
-            cv::drawContours(cmat, contours_to_draw, -1, cv::Scalar(255,255,255), 2, 16);
-            
-            if (user_params.isVerifyingContours()) {
-                if (i == 0) {
-                    std::cout << "With focus on the contours image window:" << std::endl;
-                    std::cout << "    press 't' to toggle between the contours and original image" << std::endl;
-                    std::cout << "    press 'n' to advance to the next image" << std::endl;
-                }
-                show_images("contours-" + image_number, cmat, color_images[i]);
-            }
-            if (user_params.isSavingContours()) {
-                utils::write_debug_img(user_params, cmat, "contours", image_number);
+        if (user_params.isVerifyingContours()) {
+            if (i == 0) {
+                std::cout << "With focus on the contours image window:" << std::endl;
+                std::cout << "    press 't' to toggle between the contours and original image" << std::endl;
+                std::cout << "    press 'n' to advance to the next image" << std::endl;
             }
+            show_images("contours-" + image_number, cmat, color_image);
+        }
+        if (user_params.isSavingContours()) {
+            utils::write_debug_img(user_params, cmat, "contours", image_number);
         }
+    }
+    
+    // Uncomment to save a version of the original with the piece numbers overlayed
+    /*
+    if (user_params.isSavingOriginals()) {
+        cv::Mat cmat = color_image.clone();
+        double font_scale = sqrt(bw_image.size().height * bw_image.size().width) / 1000;
+        for (uint j = 0; j < contour_mgr.contours.size(); j++) {
+            cv::Rect bounds = contour_mgr.contours[j].bounds;
+            // Text indicating contour order within the image
+            cv::putText(cmat, std::to_string(j+1), cv::Point2f(bounds.x+bounds.width/2-(10.0*font_scale),bounds.y+bounds.height/2+(10.0*font_scale)),
+                    cv::FONT_HERSHEY_COMPLEX_SMALL, font_scale, cv::Scalar(255,255,255), 2, cv::LINE_AA);                
+        }
+
+        write_debug_img(user_params, cmat, "numbered", image_number);
+    }
+    */
+    
+    for (uint j = 0; j < contour_mgr.contours.size(); j++) {
+        std::stringstream idstream;
+
+        char id_buffer[80];
+        snprintf(id_buffer, 80, "%03d-%03d-%04d", i+1, j+1, piece_number);
+        std::string piece_id(id_buffer);
         
-        // Uncomment to save a version of the original with the piece numbers overlayed
-        /*
-        if (user_params.isSavingOriginals()) {
-            cv::Mat cmat = color_images[i].clone();
-            double font_scale = sqrt(bw[i].size().height * bw[i].size().width) / 1000;
-            for (uint j = 0; j < contour_mgr.contours.size(); j++) {
-                cv::Rect bounds = contour_mgr.contours[j].bounds;
-                // Text indicating contour order within the image
-                cv::putText(cmat, std::to_string(j+1), cv::Point2f(bounds.x+bounds.width/2-(10.0*font_scale),bounds.y+bounds.height/2+(10.0*font_scale)),
-                        cv::FONT_HERSHEY_COMPLEX_SMALL, font_scale, cv::Scalar(255,255,255), 2, cv::LINE_AA);                
-            }
+        cv::Rect bounds = contour_mgr.contours[j].bounds;
+        std::vector<cv::Point> points = contour_mgr.contours[j].points;
+        
+        std::vector<cv::Point> outline = utils::translate_contour(points, PIECE_BORDER_SIZE-bounds.x, PIECE_BORDER_SIZE-bounds.y);
+        cv::Mat mini_bw = piece::outline_mask(outline, cv::Size(bounds.width+2*PIECE_BORDER_SIZE, bounds.height+2*PIECE_BORDER_SIZE));
 
-            write_debug_img(user_params, cmat, "numbered", image_number);
+        if (user_params.isSavingBlackWhite()) {
+            utils::write_debug_img(user_params, mini_bw, "bw", piece_id);
+        }
+
+        cv::Mat mini_color;
+        if (!user_params.isCompactStorage() || user_params.isSavingColor()) {
+            mini_color = piece::crop_color(color_image, bounds);
         }
-        */
         
-        for (uint j = 0; j < contour_mgr.contours.size(); j++) {
-            int bordersize = 15;
-            std::stringstream idstream;
+        if (user_params.isSavingColor()) {
+            utils::write_debug_img(user_params, mini_color, "color", piece_id);
+        }
+    
+        if (user_params.isCompactStorage()) {
+            // Only the outline and where it came from are kept
+            pieces.push_back(piece(piece_number, piece_id, filename, bounds, outline, user_params));
+        }
+        else {
+            pieces.push_back(piece(piece_number, piece_id, mini_color, mini_bw, outline, user_params));
+        }
+        
+        piece_number += 1;
+        
+    }
+}
 
-            char id_buffer[80];
-            snprintf(id_buffer, 80, "%03d-%03d-%04d", i+1, j+1, piece_number);
-            std::string piece_id(id_buffer);
-            
-            cv::Rect bounds = contour_mgr.contours[j].bounds;
-            std::vector<cv::Point> points = contour_mgr.contours[j].points;
-            
-            cv::Mat new_bw = cv::Mat::zeros(bounds.height+2*bordersize,bounds.width+2*bordersize,CV_8UC1);
-            std::vector<std::vector<cv::Point> > contours_to_draw;
-            contours_to_draw.push_back(utils::translate_contour(points, bordersize-bounds.x, bordersize-bounds.y));
-            cv::drawContours(new_bw, contours_to_draw, -1, cv::Scalar(255), COMPAT_CV_FILLED);
 
-            if (user_params.isSavingBlackWhite()) {
-                utils::write_debug_img(user_params, new_bw, "bw", piece_id);
-            }
 
-            cv::Rect b2(bounds.x-3, bounds.y-3, bounds.width+6, bounds.height+6);
-            cv::Mat color_roi = color_images[i](b2);
-            cv::Mat mini_color = cv::Mat::zeros(bounds.height+2*bordersize,bounds.width+2*bordersize,CV_8UC3);
-            color_roi.copyTo(mini_color(cv::Rect(bordersize-3,bordersize-3,b2.width,b2.height)));
-            
-            if (user_params.isSavingColor()) {
-                utils::write_debug_img(user_params, mini_color, "color", piece_id);
+
+void puzzle::fill_costs(){
+    
+    int no_edges = (int) pieces.size()*4;
+    load_seed_assembly();
+    
+    // With the quantized score engine, pairs are scored from fixed point copies of the edge contours
+    if (user_params.getScoreEngine() == "quantized") {
+        quantized = new quantized_edges(pieces);
+        logger::stream() << "Quantized edge descriptors: " << (quantized->bytes() / 1024) << " KB" << std::endl;
+        logger::flush();
+    }
+    // With the fft score engine, pairs are scored by cross-correlating the turning angles of the edges
+    if (user_params.getScoreEngine() == "fft") {
+        fft = new fft_edges(pieces);
+    }
+    
+    // Everything the scoring loop needs is set up in advance, so that the loop itself allocates nothing
+    std::vector<edge_view> views(no_edges);
+    for (int i = 0; i < no_edges; i++) {
+        views[i] = pieces[i/4].edges[i%4].view();
+    }
+    
+    // With --cascade-top-k, every pair is first scored on edges resampled to a few points, and only the
+    // best candidates of each edge are then scored at full resolution (see rescore_candidates()).
+    bool cascade = user_params.getCascadeTopK() > 0;
+    std::vector<std::vector<cv::Point2f> > coarse_contours;
+    std::vector<edge_view> coarse_views;
+    if (cascade) {
+        coarse_contours.resize(no_edges);
+        coarse_views.resize(no_edges);
+        for (int i = 0; i < no_edges; i++) {
+            coarse_contours[i] = pieces[i/4].edges[i%4].resampled_contour(CASCADE_POINTS);
+            coarse_views[i] = views[i];
+            coarse_views[i].points = coarse_contours[i].empty() ? NULL : &coarse_contours[i][0];
+            coarse_views[i].size = coarse_contours[i].size();
+        }
+    }
+    // The score of a pair at full resolution, or scaled up from its coarse score in the first stage of the cascade.
+    // The coarse escore sums over the resampled points of edge i, so it is scaled by the geometric mean of both
+    // edges' point counts, which keeps the scaling the same whichever edge of the pair comes first.
+    auto score_pair = [&](int i, int j, bool coarse) -> double {
+        double cscore;
+        double escore;
+        if (coarse) {
+            double score = edge::compare3(coarse_views[i], coarse_views[j], cscore, escore);
+            return (score == DBL_MAX) ? DBL_MAX 
+                    : cscore + escore * std::sqrt((double) views[i].size * views[j].size) / coarse_views[i].size;
+        }
+        if (quantized == NULL && fft == NULL) {
+            return edge::compare3(views[i], views[j], cscore, escore);
+        }
+        return edge_score(i, j);
+    };
+    
+    // Edges inside the seed assembly are already matched, so they aren't scored.  When the automatic solver
+    // only needs the pairs which add a piece to the seed assembly, only the pairs of an edge of the assembly
+    // with an edge of a loose piece are scored here; auto_solve() scores the others as pieces join it.
+    bool frontier_only = seed_frontier_scoring();
+    std::vector<bool> seed_edges(no_edges, false);
+    for (int i = 0; i < seed_locations.rows; i++) {
+        for (int j = 0; j < seed_locations.cols; j++) {
+            for (int e = 0; seed_locations(i,j) != -1 && e < 4; e++) {
+                seed_edges[seed_locations(i,j)*4 + e] = true;
             }
-            cv::Mat mini_bw = new_bw;
-            //Create a copy so it can't conflict.
-            mini_color = mini_color.clone();
-            mini_bw = mini_bw.clone();
-            
-            piece p(piece_number, piece_id, mini_color, mini_bw, user_params);
-            pieces.push_back(p);
-            
-            piece_number += 1;
-            
         }
     }
+    auto scored = [&](int i, int j) -> bool {
+        if (seed_interior_edges[i] || seed_interior_edges[j]) {
+            return false;
+        }
+        return !frontier_only || seed_edges[i] != seed_edges[j];
+    };
     
-    for (std::vector<piece>::iterator i= pieces.begin(); i != pieces.end(); i++) {
-        i->process();
+    // With --ann-candidates, only the pairs of each edge with the edges retrieved as its likely partners
+    // are scored, and every other pair is treated as an impossible match.
+    bool ann = user_params.getAnnCandidates() > 0;
+    std::vector<std::pair<int, int> > candidates;
+    if (ann) {
+        find_candidate_pairs(pieces, seed_interior_edges, user_params.getAnnCandidates(), candidates);
+        candidate_pairs.resize(candidates.size());
+        for (size_t k = 0; k < candidates.size(); k++) {
+            candidate_pairs[k] = (uint64_t) candidates[k].first * no_edges + candidates[k].second;
+        }
+        std::sort(candidate_pairs.begin(), candidate_pairs.end());
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](const std::pair<int, int>& pair) {
+            return !scored(pair.first, pair.second);
+        }), candidates.end());
+    }
+    
+    // Otherwise the pairs are scored in tiles of --score-tile-size x --score-tile-size edges, so that the contours of
+    // both tiles' edges stay in cache while every pair between them is scored (with a tile size of 0, each 
+    // tile is one edge paired with every following edge).  The tiles are handed out largest first, by the
+    // sum of the products of the contour lengths of their pairs, which keeps the threads evenly loaded.
+    int tile_rows = user_params.getScoreTileSize() > 0 ? user_params.getScoreTileSize() : 1;
+    int tile_cols = user_params.getScoreTileSize() > 0 ? user_params.getScoreTileSize() : no_edges;
+    std::vector<score_tile> tiles;
+    long total_pairs = 0;
+    if (ann) {
+        total_pairs = candidates.size();
+    }
+    else {
+        for (int i_begin = 0; i_begin < no_edges; i_begin += tile_rows) {
+            for (int j_begin = (i_begin / tile_cols) * tile_cols; j_begin < no_edges; j_begin += tile_cols) {
+                score_tile tile;
+                tile.i_begin = i_begin;
+                tile.i_end = std::min(no_edges, i_begin + tile_rows);
+                tile.j_begin = j_begin;
+                tile.j_end = std::min(no_edges, j_begin + tile_cols);
+                tile.work = 0.0;
+                tile.pairs = 0;
+                for (int i = tile.i_begin; i < tile.i_end; i++) {
+                    if (seed_interior_edges[i]) {
+                        continue;
+                    }
+                    for (int j = std::max(tile.j_begin, i); j < tile.j_end; j++) {
+                        if (scored(i, j)) {
+                            tile.pairs++;
+                            tile.work += (double) views[i].size * views[j].size;
+                        }
+                    }
+                }
+                if (tile.pairs > 0) {
+                    tiles.push_back(tile);
+                    total_pairs += tile.pairs;
+                }
+            }
+        }
     }
+    std::sort(tiles.begin(), tiles.end(), score_tile::compare);
+    
+    // Each pair (i, j >= i) has its own slot in 'matches' (in candidate order with --ann-candidates), so 
+    // the threads don't need to lock it.  Slots of pairs which aren't scored are marked with edge1 > edge2,
+    // and removed afterwards.
+    size_t base = matches.size();
+    match_score unscored;
+    unscored.edge1 = UINT16_MAX;
+    unscored.edge2 = 0;
+    unscored.score = DBL_MAX;
+    matches.resize(base + (ann ? candidates.size() : (size_t) no_edges * (no_edges + 1) / 2), unscored);
+    unsigned long long allocations = alloc_counter::count();
+    
+    long scored_pairs = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:scored_pairs)
+    for (int t = 0; t < (int) tiles.size(); t++) {
+        // Pairs left unscored once the scoring share of the time budget runs out are treated as impossible matches
+        if (budget.expired(SCORING_BUDGET_SHARE)) {
+            continue;
+        }
+        score_tile& tile = tiles[t];
+        scored_pairs += tile.pairs;
+        for (int i = tile.i_begin; i < tile.i_end; i++) {
+            if (seed_interior_edges[i]) {
+                continue;
+            }
+            // Index of the slot of pair (i, i)
+            size_t row = base + (size_t) i * no_edges - (size_t) i * (i - 1) / 2;
+            for (int j = std::max(tile.j_begin, i); j < tile.j_end; j++) {
+                if (!scored(i, j)) {
+                    continue;
+                }
+                match_score& score = matches[row + j - i];
+                score.edge1 = i;
+                score.edge2 = j;
+                score.score = score_pair(i, j, cascade);
+            }
+        }
+    }
+#pragma omp parallel for schedule(dynamic) reduction(+:scored_pairs)
+    for (int k = 0; k < (int) candidates.size(); k++) {
+        if (budget.expired(SCORING_BUDGET_SHARE)) {
+            continue;
+        }
+        scored_pairs++;
+        match_score& score = matches[base + k];
+        score.edge1 = candidates[k].first;
+        score.edge2 = candidates[k].second;
+        score.score = score_pair(score.edge1, score.edge2, false);
+    }
+    allocations = alloc_counter::count() - allocations;
+    if (cascade && scored_pairs == total_pairs) {
+        rescore_candidates(base, score_pair);
+    }
+    matches.erase(std::remove_if(matches.begin() + base, matches.end(), [](const match_score& score) {
+        return score.edge1 > score.edge2;
+    }), matches.end());
+    std::sort(matches.begin(),matches.end(),match_score::compare);
+    if (ann) {
+        logger::stream() << "Scored " << total_pairs << " candidate edge pairs, with " << allocations << " heap allocations" << std::endl;
+    }
+    else {
+        logger::stream() << "Scored " << total_pairs << " edge pairs in " << tiles.size() << " tiles, with " 
+                << allocations << " heap allocations" << std::endl;
+    }
+    logger::flush();
+    if (scored_pairs < total_pairs) {
+        scoring_complete = false;
+        logger::stream() << "Time budget expired while finding edge costs, scored " << scored_pairs << " of " << total_pairs << " edge pairs" << std::endl;
+        logger::flush();
+    }
+    if (user_params.isValidateScores()) {
+        validate_scores();
+    }
+    if (user_params.getRefineTopK() > 0 && scored_pairs == total_pairs) {
+        refine_candidates();
+    }
+    init_costs();
+}
 
-    return pieces;
+// The score of a pair of edges by the selected --score-engine, along with its parts as checked against the
+// limits by within_limits().  With the fft engine, escore is the RMS turning angle difference.  Pairs refined
+// by refine_candidates() are scored after the same alignment.  Safe to call concurrently.
+double puzzle::edge_score(int edge1, int edge2, double& cscore, double& escore) const {
+    if (!refined_pairs.empty()) {
+        uint64_t key = (uint64_t) std::min(edge1, edge2) * pieces.size()*4 + std::max(edge1, edge2);
+        if (std::binary_search(refined_pairs.begin(), refined_pairs.end(), key)) {
+            return edge::compare_aligned(pieces[edge1/4].edges[edge1%4].view(), pieces[edge2/4].edges[edge2%4].view(), 
+                    cscore, escore);
+        }
+    }
+    if (quantized != NULL) {
+        return quantized->compare(edge1, edge2, cscore, escore);
+    }
+    if (fft != NULL) {
+        return fft->compare(edge1, edge2, cscore, escore);
+    }
+    return pieces[edge1/4].edges[edge1%4].compare3(pieces[edge2/4].edges[edge2%4], cscore, escore);
+}
+
+// True if a pair with the given edge_score() may be joined automatically
+bool puzzle::within_limits(double score, double cscore, double escore, params& limits) const {
+    double escore_limit = (fft != NULL) ? limits.getFftAngleLimit() : limits.getEscoreLimit();
+    return score != DBL_MAX && cscore <= limits.getCscoreLimit() && escore <= escore_limit;
+}
+
+// The score of a pair of edges by the selected --score-engine, as accepted by within_limits().  Safe to 
+// call concurrently.
+double puzzle::edge_score(int edge1, int edge2) const {
+    double cscore;
+    double escore;
+    return edge_score(edge1, edge2, cscore, escore);
 }
 
+// False for the pairs which --ann-candidates treats as impossible matches
+bool puzzle::is_candidate(int edge1, int edge2) const {
+    if (user_params.getAnnCandidates() == 0) {
+        return true;
+    }
+    int no_edges = (int) pieces.size()*4;
+    uint64_t key = (uint64_t) std::min(edge1, edge2) * no_edges + std::max(edge1, edge2);
+    return std::binary_search(candidate_pairs.begin(), candidate_pairs.end(), key);
+}
 
+// True if the solver looks up scores of arbitrary pairs of edges (see init_costs())
+bool puzzle::needs_score_table() const {
+    return !user_params.isGuidedSolution() 
+            && (user_params.getSolverStrategy() == "genetic" || user_params.getRefineTime() > 0);
+}
 
+// True if fill_costs() only scores the pairs joining the seed assembly to a loose piece, because only
+// the automatic solver (which extends the matches as pieces join the assembly) will use them
+bool puzzle::seed_frontier_scoring() const {
+    return seed_piece != -1 && !user_params.isGuidedSolution() && !needs_score_table();
+}
 
-void puzzle::fill_costs(){
-    
+// Only the genetic solver and --refine-time look up the scores of arbitrary pairs of edges, often enough
+// to need them in a table, which holds (number of edges)^2 scores, or with --ann-candidates only the
+// scores of the candidate pairs.  Otherwise (as for the totals of --multi-start configurations) the few
+// scores needed are computed when they are looked up, and those of pairs which aren't --ann-candidates
+// are impossible matches, as in the table.
+void puzzle::init_costs() {
     int no_edges = (int) pieces.size()*4;
+    if (!needs_score_table()) {
+        costs.init(no_edges, [this](int edge1, int edge2) { 
+            return is_candidate(edge1, edge2) ? edge_score(edge1, edge2) : DBL_MAX; 
+        });
+        return;
+    }
+    if (user_params.getAnnCandidates() > 0) {
+        std::vector<std::pair<int, int> > pairs(matches.size());
+        for (size_t k = 0; k < matches.size(); k++) {
+            pairs[k] = std::make_pair(matches[k].edge1, matches[k].edge2);
+        }
+        costs.init(no_edges, pairs);
+    }
+    else {
+        costs.init(no_edges);
+    }
+    for (size_t k = 0; k < matches.size(); k++) {
+        costs.set(matches[k].edge1, matches[k].edge2, matches[k].score);
+    }
+    logger::stream() << "Edge score table: " << (costs.bytes() / 1024) << " KB" << std::endl;
+    logger::flush();
+}
+
+// Adds a candidate to a max-heap (by score) holding the best 'count' candidates offered so far
+static void offer_candidate(std::vector<std::pair<double, size_t> >& heap, const std::pair<double, size_t>& candidate, uint count) {
+    if (heap.size() < count) {
+        heap.push_back(candidate);
+        std::push_heap(heap.begin(), heap.end());
+    }
+    else if (count > 0 && candidate < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end());
+    }
+}
+
+// The second stage of the scoring cascade: the pairs formed by each edge and its --cascade-top-k best
+// candidates by coarse score are scored again at full resolution.  The other pairs keep their coarse
+// scores.  The matches of the pairs scored by fill_costs() start at index 'base' in 'matches'.
+template<class score_function>
+void puzzle::rescore_candidates(size_t base, score_function& score_pair) {
+    int no_edges = (int) pieces.size()*4;
+    uint top_k = user_params.getCascadeTopK();
     
-    //TODO: use openmp to speed up this loop w/o blocking the commented lines below
-//    omp_set_num_threads(4);
+    // Each thread keeps the best candidates of each edge among the rows it scans, as (score, index into
+    // 'matches'), so the threads share nothing until their candidates are merged.
+    typedef std::pair<double, size_t> candidate;
+    std::vector<std::vector<std::vector<candidate> > > thread_best(omp_get_max_threads(), 
+            std::vector<std::vector<candidate> >(no_edges));
 #pragma omp parallel for schedule(dynamic)
-    for(int i =0; i<no_edges; i++){
-        for(int j=i; j<no_edges; j++){
-            match_score score;
-            score.edge1 =(int) i;
-            score.edge2 =(int) j;
-            score.score = pieces[i/4].edges[i%4].compare3(pieces[j/4].edges[j%4]);
-#pragma omp critical
-{
-            matches.push_back(score);
+    for (int i = 0; i < no_edges; i++) {
+        std::vector<std::vector<candidate> >& best = thread_best[omp_get_thread_num()];
+        size_t row = base + (size_t) i * no_edges - (size_t) i * (i - 1) / 2;
+        for (int j = i; j < no_edges; j++) {
+            const match_score& score = matches[row + j - i];
+            if (score.edge1 > score.edge2 || score.score == DBL_MAX) {
+                continue;
+            }
+            offer_candidate(best[i], candidate(score.score, row + j - i), top_k);
+            if (j != i) {
+                offer_candidate(best[j], candidate(score.score, row + j - i), top_k);
+            }
+        }
+    }
+    
+    std::vector<std::vector<size_t> > edge_best(no_edges);
+#pragma omp parallel for schedule(dynamic)
+    for (int e = 0; e < no_edges; e++) {
+        std::vector<candidate> merged;
+        for (uint t = 0; t < thread_best.size(); t++) {
+            merged.insert(merged.end(), thread_best[t][e].begin(), thread_best[t][e].end());
+        }
+        uint count = std::min((uint) merged.size(), top_k);
+        std::partial_sort(merged.begin(), merged.begin() + count, merged.end());
+        for (uint k = 0; k < count; k++) {
+            edge_best[e].push_back(merged[k].second);
+        }
+    }
+    thread_best.clear();
+    
+    // A pair among the best of both its edges is rescored once
+    std::vector<size_t> rescore;
+    for (int e = 0; e < no_edges; e++) {
+        rescore.insert(rescore.end(), edge_best[e].begin(), edge_best[e].end());
+    }
+    std::sort(rescore.begin(), rescore.end());
+    rescore.erase(std::unique(rescore.begin(), rescore.end()), rescore.end());
+    
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < (int) rescore.size(); k++) {
+        match_score& score = matches[rescore[k]];
+        score.score = score_pair(score.edge1, score.edge2, false);
+    }
+    logger::stream() << "Scoring cascade: rescored " << rescore.size() << " edge pairs at full resolution" << std::endl;
+    logger::flush();
 }
+
+// Reports how closely the order of the quantized or fft scores follows the order of the exact compare3()
+// scores, as the Spearman rank correlation over a random sample of the possible pairs.
+void puzzle::validate_scores() {
+    std::vector<size_t> possible;
+    for (size_t k = 0; k < matches.size(); k++) {
+        if (matches[k].score != DBL_MAX) {
+            possible.push_back(k);
         }
     }
-    std::sort(matches.begin(),matches.end(),match_score::compare);
+    std::mt19937 rng(1);
+    std::shuffle(possible.begin(), possible.end(), rng);
+    possible.resize(std::min(possible.size(), (size_t) SCORE_VALIDATION_SAMPLES));
+    
+    std::vector<double> engine_scores(possible.size());
+    std::vector<double> exact_scores(possible.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < (int) possible.size(); k++) {
+        match_score& score = matches[possible[k]];
+        engine_scores[k] = score.score;
+        exact_scores[k] = pieces[score.edge1/4].edges[score.edge1%4].compare3(pieces[score.edge2/4].edges[score.edge2%4]);
+    }
+    
+    logger::stream() << "Score engine '" << user_params.getScoreEngine() << "' rank correlation with compare3 over "
+            << possible.size() << " pairs: " << utils::rank_correlation(engine_scores, exact_scores) << std::endl;
+    logger::flush();
 }
 
-void puzzle::auto_solve(PuzzleDisjointSet& p) {
+// Rescores the --refine-top-k best pairs of each edge with edge::compare_aligned(), which lets the edges
+// shift and rotate against each other, and re-ranks the matches by the refined scores.  The refined pairs
+// are remembered, so that check_match() accepts or rejects them by the same aligned comparison.  Sweeping the matches
+// best first, a pair is refined while either of its edges has fewer than K refined pairs, so at most
+// (number of edges) * K pairs are refined.
+void puzzle::refine_candidates() {
+    int no_edges = (int) pieces.size()*4;
+    uint top_k = user_params.getRefineTopK();
+    std::vector<uint> refined_count(no_edges, 0);
+    std::vector<size_t> finalists;
+    for (size_t k = 0; k < matches.size(); k++) {
+        match_score& score = matches[k];
+        // Matches inside the seed assembly are already known to be right
+        if (score.score == DBL_MAX || seed_interior_edges[score.edge1] || seed_interior_edges[score.edge2]) {
+            continue;
+        }
+        if (refined_count[score.edge1] < top_k || refined_count[score.edge2] < top_k) {
+            refined_count[score.edge1]++;
+            refined_count[score.edge2]++;
+            finalists.push_back(k);
+        }
+    }
+    
+    long improved = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:improved)
+    for (int k = 0; k < (int) finalists.size(); k++) {
+        match_score& score = matches[finalists[k]];
+        edge_view a = pieces[score.edge1/4].edges[score.edge1%4].view();
+        edge_view b = pieces[score.edge2/4].edges[score.edge2%4].view();
+        double cscore;
+        double escore;
+        double refined = edge::compare_aligned(a, b, cscore, escore);
+        if (refined < score.score) {
+            score.score = refined;
+            improved++;
+        }
+    }
+    
+    refined_pairs.clear();
+    for (size_t k = 0; k < finalists.size(); k++) {
+        const match_score& score = matches[finalists[k]];
+        refined_pairs.push_back((uint64_t) std::min(score.edge1, score.edge2) * no_edges + std::max(score.edge1, score.edge2));
+    }
+    std::sort(refined_pairs.begin(), refined_pairs.end());
+    std::stable_sort(matches.begin(), matches.end(), match_score::compare);
+    logger::stream() << "Refined " << finalists.size() << " candidate edge pairs by ICP alignment, " << improved
+            << " scored better" << std::endl;
+    logger::flush();
+}
+
+puzzle::solve_config::solve_config(puzzle* owner, params& config_params, uint tie_seed) 
+    : owner(owner), config_params(config_params), tie_seed(tie_seed) {
+    set_size = 0;
+    adjacent_pairs = 0;
+    total_score = 0.0;
+}
+
+void puzzle::auto_solve(PuzzleDisjointSet& p, solve_config& config) {
     int output_id=0;
+    params& config_params = config.config_params;
     
+    std::mt19937 rng(config.tie_seed);
+    // Indices into 'candidates' for the current run of tied scores, in the order they will be tried
+    std::vector<size_t> run;
+    size_t run_pos = 0;
+    size_t next = 0;
+    // With a seed assembly only matches which join a piece or group onto the seed set are taken, so
+    // the matches are passed over repeatedly, as each join exposes new edges to match against.
+    bool joined = false;
+    // If fill_costs() only scored the pairs of the seed assembly's edges with the loose pieces' edges, 
+    // this configuration works on its own copy of the matches, extended after each pass with the pairs
+    // of the pieces which joined the assembly.
+    bool frontier_only = seed_frontier_scoring();
+    std::vector<match_score> frontier_matches;
+    std::vector<bool> in_seed;
+    if (frontier_only) {
+        frontier_matches = matches;
+        int seed_rep = p.find(seed_piece);
+        for (uint k = 0; k < pieces.size(); k++) {
+            in_seed.push_back(p.find(k) == seed_rep);
+        }
+    }
+    std::vector<match_score>& candidates = frontier_only ? frontier_matches : matches;
     
-    std::vector<match_score>::iterator i= matches.begin();
-    while(!p.in_one_set() && i!=matches.end() ){
+    while(!p.in_one_set() && !budget.expired()){
+        if (run_pos == run.size() && next == candidates.size()) {
+            if (seed_piece == -1 || !joined) {
+                break;
+            }
+            if (frontier_only) {
+                extend_frontier_matches(p, in_seed, frontier_matches);
+            }
+            next = 0;
+            joined = false;
+        }
+
+        if (run_pos == run.size()) {
+            size_t end = next + 1;
+            if (config.tie_seed != 0 && candidates[next].score != DBL_MAX) {
+                double limit = candidates[next].score * (1.0 + TIE_TOLERANCE);
+                while (end < candidates.size() && candidates[end].score <= limit) {
+                    end++;
+                }
+            }
+            run.clear();
+            for (size_t k = next; k < end; k++) {
+                run.push_back(k);
+            }
+            std::shuffle(run.begin(), run.end(), rng);
+            run_pos = 0;
+            next = end;
+        }
+        std::vector<match_score>::iterator i = candidates.begin() + run[run_pos++];
+        
         int p1 = i->edge1/4;
         int e1 = i->edge1%4;
         int p2 = i->edge2/4;
         int e2 = i->edge2%4;
         
-        if (user_params.isSavingMatches()) {
+        if (seed_piece != -1) {
+            int seed_rep = p.find(seed_piece);
+            if ((p.find(p1) == seed_rep) == (p.find(p2) == seed_rep)) {
+                continue;
+            }
+        }
+        
+        if (config_params.isSavingMatches()) {
             cv::Mat m = cv::Mat::zeros(500,500,CV_8UC1);
             std::stringstream out_file_name;
-            out_file_name << user_params.getOutputDir() << "match" << output_id << "_" << pieces[p1].get_id() << "-" << e1 << "_" << pieces[p2].get_id() << "-" <<e2 << ".png";
+            out_file_name << config_params.getOutputDir() << "match" << output_id << "_" << pieces[p1].get_id() << "-" << e1 << "_" << pieces[p2].get_id() << "-" <<e2 << ".png";
             std::vector<std::vector<cv::Point> > contours;
             contours.push_back(pieces[p1].edges[e1].get_translated_contour(200, 0));
             contours.push_back(pieces[p2].edges[e2].get_translated_contour_reverse(200, 0));
             cv::polylines(m, contours, false, cv::Scalar(255));
             cv::imwrite(out_file_name.str(), m);
         }
-        if (user_params.isVerbose()) {
+        if (config_params.isVerbose()) {
             logger::stream() << "Attempting to merge: " << pieces[p1].get_id() << "-" << (e1+1) << " with: " << 
                     pieces[p2].get_id() << "-" << (e2+1) << ", score:" << i->score << " count: "  << output_id <<std::endl;
             logger::flush();
@@ -285,12 +918,115 @@ void puzzle::auto_solve(PuzzleDisjointSet& p) {
         p.compute_join(c);
         if (c.joinable) {
             p.complete_join(c);
+            joined = true;
         }
-        i++;
         output_id += 1;
     }    
 }
 
+// Scores the pairs of each edge of the pieces which have joined the seed assembly since in_seed was last
+// updated with each edge of the pieces still outside it, and merges them into the sorted 'frontier'.
+void puzzle::extend_frontier_matches(PuzzleDisjointSet& p, std::vector<bool>& in_seed, std::vector<match_score>& frontier) {
+    int seed_rep = p.find(seed_piece);
+    std::vector<int> joined_pieces;
+    std::vector<int> loose_pieces;
+    for (uint k = 0; k < pieces.size(); k++) {
+        bool now = p.find(k) == seed_rep;
+        if (now && !in_seed[k]) {
+            joined_pieces.push_back(k);
+            in_seed[k] = true;
+        }
+        else if (!now) {
+            loose_pieces.push_back(k);
+        }
+    }
+    
+    std::vector<std::vector<match_score> > found(joined_pieces.size()*4);
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < (int) found.size(); k++) {
+        int edge1 = joined_pieces[k/4]*4 + k%4;
+        for (uint l = 0; l < loose_pieces.size(); l++) {
+            for (int e = 0; e < 4; e++) {
+                int edge2 = loose_pieces[l]*4 + e;
+                if (!is_candidate(edge1, edge2)) {
+                    continue;
+                }
+                match_score score;
+                score.edge1 = std::min(edge1, edge2);
+                score.edge2 = std::max(edge1, edge2);
+                score.score = edge_score(score.edge1, score.edge2);
+                if (score.score != DBL_MAX) {
+                    found[k].push_back(score);
+                }
+            }
+        }
+    }
+    
+    size_t old_size = frontier.size();
+    for (uint k = 0; k < found.size(); k++) {
+        frontier.insert(frontier.end(), found[k].begin(), found[k].end());
+    }
+    std::sort(frontier.begin() + old_size, frontier.end(), match_score::compare);
+    std::inplace_merge(frontier.begin(), frontier.begin() + old_size, frontier.end(), match_score::compare);
+}
+
+// Runs several solver configurations concurrently over the shared (read-only) edge scores.  Each
+// configuration scales the cscore/escore limits and/or shuffles near-tied matches, and assembles
+// pieces into its own PuzzleDisjointSet.  The most complete assembly with the lowest total score wins.
+void puzzle::multi_start_solve() {
+    int count = user_params.getMultiStartCount();
+    
+    std::vector<solve_config> configs;
+    for (int k = 0; k < count; k++) {
+        solve_config config(this, user_params, k / MULTI_START_LIMIT_SCALES);
+        float scale = multi_start_limit_scales[k % MULTI_START_LIMIT_SCALES];
+        config.config_params.setCscoreLimit(user_params.getCscoreLimit() * scale);
+        config.config_params.setEscoreLimit(user_params.getEscoreLimit() * scale);
+        config.config_params.setFftAngleLimit(user_params.getFftAngleLimit() * scale);
+        // The configurations run concurrently, so keep them quiet
+        config.config_params.setVerbose(false);
+        config.config_params.setSaveAll(false);
+        config.config_params.setSavingMatches(false);
+        configs.push_back(config);
+    }
+    
+    logger::stream() << "Running " << count << " solver configurations..." << std::endl;
+    logger::flush();
+    
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < count; k++) {
+        solve_config& config = configs[k];
+        PuzzleDisjointSet p(config.config_params, pieces.size(), match_check_function, &config);
+        seed_set(p);
+        auto_solve(p, config);
+        int rep = p.largest_set();
+        config.set = p.get(rep);
+        config.set_size = p.set_size(rep);
+        config.total_score = costs.grid_score(config.set.locations, config.set.rotations, config.adjacent_pairs);
+    }
+    
+    int best = 0;
+    for (int k = 0; k < count; k++) {
+        solve_config& config = configs[k];
+        logger::stream() << "Configuration " << (k+1) 
+                << " (cscore limit " << config.config_params.getCscoreLimit() 
+                << ", escore limit " << config.config_params.getEscoreLimit() 
+                << ", tie seed " << config.tie_seed << "): "
+                << config.set_size << " of " << pieces.size() << " pieces, " 
+                << config.adjacent_pairs << " adjacent edges, total score " << config.total_score << std::endl;
+        if (config.set_size > configs[best].set_size || 
+                (config.set_size == configs[best].set_size && config.total_score < configs[best].total_score)) {
+            best = k;
+        }
+    }
+    logger::stream() << "Best result from configuration " << (best+1) << std::endl;
+    logger::flush();
+    
+    if (configs[best].set_size == (int) pieces.size() || budget.expired()) {
+        set_solution(configs[best].set);
+    }
+}
+
 // Unlike auto_solve, in which the sets managed by PuzzleDisjointSet randomly coalesce during the solution phase,
 // guided_solve attempts to help the human operator by keeping the number of matched sets down to a minimum
 void puzzle::guided_solve(PuzzleDisjointSet& p) {
@@ -311,9 +1047,9 @@ void puzzle::guided_solve(PuzzleDisjointSet& p) {
     }
     
     
-    while (!p.in_one_set()) {
+    while (!p.in_one_set() && !budget.expired()) {
         std::vector<match_score>::iterator i= matches.begin();
-        while(!p.in_one_set() && i!=matches.end() ) {
+        while(!p.in_one_set() && i!=matches.end() && !budget.expired()) {
             int p1 = i->edge1/4;
             int e1 = i->edge1%4;
             int p2 = i->edge2/4;
@@ -431,23 +1167,20 @@ void puzzle::guided_solve(PuzzleDisjointSet& p) {
     }
 }
 
-bool match_check_function(void* data, int p1, int p2, int e1, int e2) {
-    puzzle* p = (puzzle*)data;
-    return p->check_match(p1, p2, e1, e2);
+bool puzzle::match_check_function(void* data, int p1, int p2, int e1, int e2) {
+    solve_config* config = (solve_config*)data;
+    return config->owner->check_match(p1, p2, e1, e2, config->config_params);
 }
 
-bool puzzle::check_match(int p1, int p2, int e1, int e2) {
+bool puzzle::check_match(int p1, int p2, int e1, int e2, params& limits) {
     double cscore;
     double escore;
-    double score = pieces[p1].edges[e1].compare3(pieces[p2].edges[e2], cscore, escore);
-    if (user_params.isVerbose()) {
+    double score = edge_score(p1*4 + e1, p2*4 + e2, cscore, escore);
+    if (limits.isVerbose()) {
         std::cout << "check_match(" << (p1+user_params.getInitialPieceId()) << ", " << (p2+user_params.getInitialPieceId()) 
                 << ", " << e1 << ", " << e2 << ")=" << cscore << " / " << escore << std::endl;
     }
-    if (score == DBL_MAX || cscore > user_params.getCscoreLimit() || escore > user_params.getEscoreLimit()) {
-        return false;
-    }
-    return true;
+    return within_limits(score, cscore, escore, limits);
 }
 
 //Solves the puzzle
@@ -456,11 +1189,34 @@ void puzzle::solve(){
     load_guided_matches();
     load_boundary_edges();
     
-    PuzzleDisjointSet p(user_params, pieces.size(), match_check_function, this);
+    if (!user_params.isGuidedSolution() && user_params.getSolverStrategy() == "genetic") {
+        std::vector<pieceType> piece_types;
+        std::vector<bool> outer_edges;
+        for (uint i = 0; i < pieces.size(); i++) {
+            piece_types.push_back(pieces[i].get_type());
+            for (int j = 0; j < 4; j++) {
+                outer_edges.push_back(pieces[i].edges[j].get_type() == OUTER_EDGE);
+            }
+        }
+        PuzzleDisjointSet::forest f;
+        if (genetic_solve(costs, piece_types, outer_edges, user_params, budget, f.locations, f.rotations)) {
+            set_solution(f);
+        }
+        return;
+    }
+    
+    if (!user_params.isGuidedSolution() && user_params.getMultiStartCount() > 1) {
+        multi_start_solve();
+        return;
+    }
+    
+    solve_config config(this, user_params, 0);
+    PuzzleDisjointSet p(config.config_params, pieces.size(), match_check_function, &config);
     // PuzzleDisjointSet p(user_params, pieces.size(), NULL, NULL);
+    seed_set(p);
     
     if (!user_params.isGuidedSolution()) {
-        auto_solve(p);
+        auto_solve(p, config);
     }
     else {
         guided_solve(p);
@@ -469,19 +1225,227 @@ void puzzle::solve(){
     p.finish();
     
     if(p.in_one_set()){
+        PuzzleDisjointSet::forest f = p.get(p.find(1));
+        set_solution(f);
+    }
+    else if (budget.expired()) {
+        PuzzleDisjointSet::forest f = p.get(p.largest_set());
+        set_solution(f);
+    }
+}
+
+void puzzle::set_solution(PuzzleDisjointSet::forest& f) {
+    int placed = 0;
+    for (int i = 0; i < f.locations.rows; i++) {
+        for (int j = 0; j < f.locations.cols; j++) {
+            if (f.locations(i,j) != -1) placed++;
+        }
+    }
+    if (placed < (int) pieces.size()) {
+        if (budget.expired()) {
+            logger::stream() << "Time budget expired, keeping the largest group found so far (" << placed << " of " << pieces.size() << " pieces)" << std::endl;
+        }
+        else {
+            logger::stream() << "No complete solution found, keeping the largest group (" << placed << " of " << pieces.size() << " pieces)" << std::endl;
+        }
+        if (!scoring_complete) {
+            logger::stream() << "Not every edge pair was scored within the time budget, so some matches were never tried" << std::endl;
+        }
+    }
+    else {
         logger::stream() << "Possible solution found" << std::endl;
+    }
+    logger::flush();
+    solved = true;
+    solution = f.locations;
+    solution_rotations = f.rotations;
+    
+    double refine_time = std::min((double) user_params.getRefineTime(), budget.remaining());
+    if (refine_time > 0 && !user_params.isGuidedSolution() && !costs.empty()) {
+        logger::stream() << "Refining solution for up to " << refine_time << " seconds..." << std::endl;
         logger::flush();
-        solved = true;
-        PuzzleDisjointSet::forest f = p.get(p.find(1));
-        solution = f.locations;
-        solution_rotations = f.rotations;
-        
-        for(int i =0; i<solution.size[0]; i++){
-            for(int j=0; j<solution.size[1]; j++){
-                int piece_number = solution(i,j);
+        // Pieces of the seed assembly stay where they are
+        std::vector<bool> fixed_pieces(pieces.size(), false);
+        for (int i = 0; i < seed_locations.rows; i++) {
+            for (int j = 0; j < seed_locations.cols; j++) {
+                if (seed_locations(i,j) != -1) fixed_pieces[seed_locations(i,j)] = true;
+            }
+        }
+        anneal_solution(costs, solution, solution_rotations, fixed_pieces, refine_time, user_params.isVerbose());
+    }
+    
+    for(int i =0; i<solution.size[0]; i++){
+        for(int j=0; j<solution.size[1]; j++){
+            int piece_number = solution(i,j);
+            if (piece_number != -1) {
                 pieces[piece_number].rotate(4-solution_rotations(i,j));
             }
-        }   
+        }
+    }   
+}
+
+// Reads the --seed-assembly file.  Each line is a row of the assembled region, with comma separated cells
+// holding "id" or "id:rotation" (rotations as in the solution output), or "-" or nothing for empty cells,
+// so the grid of piece IDs from a saved solution text can be reused directly.  Also works out which edges face another
+// piece of the assembly; those edges are left out of the edge costs and the solver's candidate matches.
+void puzzle::load_seed_assembly() {
+    seed_interior_edges.assign(pieces.size()*4, false);
+    std::string filename = user_params.getSeedAssemblyFile();
+    if (filename.empty()) {
+        return;
+    }
+    
+    std::ifstream istream;
+    istream.open(filename, std::ifstream::in);
+    if (istream.fail()) {
+        logger::stream() << "Error, unable to read seed assembly file " << filename << std::endl;
+        logger::flush();
+        exit(1);
+    }
+    
+    std::vector<std::vector<int> > rows_ids;
+    std::vector<std::vector<int> > rows_rotations;
+    std::vector<bool> seen(pieces.size(), false);
+    size_t cols = 0;
+    int empty_rows = 0; // empty rows since the last row with a piece
+    std::string line;
+    while (std::getline(istream, line)) {
+        std::vector<int> ids;
+        std::vector<int> rotations;
+        std::stringstream linestream(line);
+        std::string cell;
+        while (std::getline(linestream, cell, ',')) {
+            size_t first = cell.find_first_not_of(" \t\r");
+            cell = (first == std::string::npos) ? "" : cell.substr(first, cell.find_last_not_of(" \t\r") - first + 1);
+            if (cell.empty() || cell == "-") {
+                ids.push_back(-1);
+                rotations.push_back(0);
+                continue;
+            }
+            
+            std::stringstream cellstream(cell);
+            int id;
+            int rotation = 0;
+            char separator;
+            cellstream >> id;
+            if (!cellstream.fail() && !cellstream.eof()) {
+                cellstream >> separator >> rotation;
+                if (separator != ':') {
+                    cellstream.setstate(std::ios::failbit);
+                }
+            }
+            int piece_number = id - user_params.getInitialPieceId();
+            if (cellstream.fail() || !cellstream.eof() || piece_number < 0 || piece_number >= (int) pieces.size() 
+                    || rotation < 0 || rotation > 3 || seen[piece_number]) {
+                logger::stream() << "Error, invalid or repeated seed assembly cell '" << cell << "' in " << filename << std::endl;
+                logger::flush();
+                exit(1);
+            }
+            seen[piece_number] = true;
+            ids.push_back(piece_number);
+            rotations.push_back(rotation);
+        }
+        while (!ids.empty() && ids.back() == -1) {
+            ids.pop_back();
+            rotations.pop_back();
+        }
+        // An empty row would change the shape of the region, so it's only allowed after the last row
+        if (ids.empty()) {
+            empty_rows++;
+            continue;
+        }
+        if (empty_rows > 0) {
+            logger::stream() << "Error, seed assembly file " << filename << " has an empty row before row " 
+                    << (rows_ids.size() + empty_rows + 1) << std::endl;
+            logger::flush();
+            exit(1);
+        }
+        cols = std::max(cols, ids.size());
+        rows_ids.push_back(ids);
+        rows_rotations.push_back(rotations);
+    }
+    istream.close();
+    
+    if (rows_ids.empty()) {
+        return;
+    }
+    
+    seed_locations = cv::Mat_<int>(rows_ids.size(), cols, -1);
+    seed_rotations = cv::Mat_<int>(rows_ids.size(), cols, 0);
+    int count = 0;
+    for (int i = 0; i < seed_locations.rows; i++) {
+        for (uint j = 0; j < rows_ids[i].size(); j++) {
+            seed_locations(i,j) = rows_ids[i][j];
+            seed_rotations(i,j) = rows_rotations[i][j];
+            if (rows_ids[i][j] != -1) {
+                seed_piece = rows_ids[i][j];
+                count++;
+            }
+        }
+    }
+    
+    // The region is seeded as one matched group, so its pieces must all be connected
+    cv::Mat_<uchar> reached(seed_locations.rows, seed_locations.cols, (uchar) 0);
+    std::vector<cv::Point> stack;
+    for (int i = 0; i < seed_locations.rows && stack.empty(); i++) {
+        for (int j = 0; j < seed_locations.cols && stack.empty(); j++) {
+            if (seed_locations(i,j) != -1) {
+                reached(i,j) = 1;
+                stack.push_back(cv::Point(j, i));
+            }
+        }
+    }
+    int connected = 0;
+    while (!stack.empty()) {
+        cv::Point cell = stack.back();
+        stack.pop_back();
+        connected++;
+        const cv::Point neighbours[4] = { cv::Point(cell.x-1, cell.y), cv::Point(cell.x+1, cell.y), 
+                cv::Point(cell.x, cell.y-1), cv::Point(cell.x, cell.y+1) };
+        for (int k = 0; k < 4; k++) {
+            cv::Point n = neighbours[k];
+            if (n.x >= 0 && n.y >= 0 && n.x < seed_locations.cols && n.y < seed_locations.rows 
+                    && seed_locations(n.y,n.x) != -1 && !reached(n.y,n.x)) {
+                reached(n.y,n.x) = 1;
+                stack.push_back(n);
+            }
+        }
+    }
+    if (connected < count) {
+        logger::stream() << "Error, the pieces of seed assembly file " << filename << " aren't all connected (" 
+                << connected << " of " << count << " pieces are joined to the first)" << std::endl;
+        logger::flush();
+        exit(1);
+    }
+    
+    int interior = 0;
+    for (int i = 0; i < seed_locations.rows; i++) {
+        for (int j = 0; j < seed_locations.cols; j++) {
+            if (seed_locations(i,j) == -1) {
+                continue;
+            }
+            // Look right and down; both edges of each adjacent pair are interior
+            if (j+1 < seed_locations.cols && seed_locations(i,j+1) != -1) {
+                seed_interior_edges[seed_locations(i,j)*4 + score_table::edge_at(seed_rotations(i,j), SIDE_RIGHT)] = true;
+                seed_interior_edges[seed_locations(i,j+1)*4 + score_table::edge_at(seed_rotations(i,j+1), SIDE_LEFT)] = true;
+                interior += 2;
+            }
+            if (i+1 < seed_locations.rows && seed_locations(i+1,j) != -1) {
+                seed_interior_edges[seed_locations(i,j)*4 + score_table::edge_at(seed_rotations(i,j), SIDE_BOTTOM)] = true;
+                seed_interior_edges[seed_locations(i+1,j)*4 + score_table::edge_at(seed_rotations(i+1,j), SIDE_TOP)] = true;
+                interior += 2;
+            }
+        }
+    }
+    
+    logger::stream() << "Loaded seed assembly of " << count << " pieces (" << seed_locations.rows << "x" << seed_locations.cols 
+            << "), " << interior << " of " << seed_interior_edges.size() << " edges are inside it" << std::endl;
+    logger::flush();
+}
+
+void puzzle::seed_set(PuzzleDisjointSet& p) {
+    if (seed_piece != -1) {
+        p.seed(seed_locations, seed_rotations);
     }
 }
 
@@ -620,10 +1584,10 @@ std::string puzzle::guide_match(int p1, int p2, int e1, int e2) {
     
     double cscore;
     double escore;
-    double score = pieces[p1].edges[e1].compare3(pieces[p2].edges[e2], cscore, escore);
+    double score = edge_score(p1*4 + e1, p2*4 + e2, cscore, escore);
 
     std::string response;
-    if (score == DBL_MAX || cscore > user_params.getCscoreLimit() || escore > user_params.getEscoreLimit()) {
+    if (!within_limits(score, cscore, escore, user_params)) {
       response = "no";
     } else {
       std::cout << "Does piece " << (p1 + user_params.getInitialPieceId()) 
@@ -707,8 +1671,8 @@ std::string puzzle::get_solution_image_pathname() {
 
 
 //Saves an image of the representation of the puzzle.
-//only really works when there are no holes
-//TODO: fail when puzzle is in configurations that are not possible i.e. holes
+//Holes (e.g. in a partial solution) are left empty, with their corner points estimated from the
+//neighbouring points and the average piece size so that the rest of the grid still lines up.
 void puzzle::save_solution_image(){
     if(!solved) solve();
     
@@ -722,6 +1686,15 @@ void puzzle::save_solution_image(){
     for(int i = 0; i < solution.size[0]+1; ++i)
         points[i] = new cv::Point2f[solution.size[1]+1];
     bool failed=false;
+    // The piece number and transform of each piece to draw
+    std::vector<std::pair<int, cv::Mat> > layers;
+    
+    float average_x_dist = 0;
+    float average_y_dist = 0;
+    for (uint k = 0; k < pieces.size(); k++) {
+        average_x_dist += (float) cv::norm(pieces[k].get_corner(0)-pieces[k].get_corner(3)) / pieces.size();
+        average_y_dist += (float) cv::norm(pieces[k].get_corner(0)-pieces[k].get_corner(1)) / pieces.size();
+    }
     
     logger::stream() << "Saving image..." << std::endl;
     logger::flush();
@@ -732,7 +1705,16 @@ void puzzle::save_solution_image(){
 
             if(piece_number ==-1){
                 failed = true;
-                // break;
+                if(i==0 && j==0){
+                    points[i][j] = cv::Point2f(border,border);
+                }
+                if(i==0){
+                    points[i][j+1] = cv::Point2f(points[i][j].x+border+average_x_dist,border);
+                }
+                if(j==0){
+                    points[i+1][j] = cv::Point2f(border,points[i][j].y+border+average_y_dist);
+                }
+                points[i+1][j+1] = points[i+1][j] + (points[i][j+1] - points[i][j]);
                 continue;
             }
             float x_dist =(float) cv::norm(pieces[piece_number].get_corner(0)-pieces[piece_number].get_corner(3));
@@ -769,20 +1751,30 @@ void puzzle::save_solution_image(){
             
             
             
-            cv::Mat layer;
-            cv::Mat layer_mask;
-            
-            int layer_size = out_image_size;
-            
-            cv::warpAffine(pieces[piece_number].full_color, layer, a_trans_mat, cv::Size2i(layer_size,layer_size),cv::INTER_LINEAR,cv::BORDER_TRANSPARENT);
-            cv::warpAffine(pieces[piece_number].bw, layer_mask, a_trans_mat, cv::Size2i(layer_size,layer_size),cv::INTER_NEAREST,cv::BORDER_TRANSPARENT);
-            
-            layer.copyTo(out_image(cv::Rect(0,0,layer_size,layer_size)), layer_mask);
-            
+            layers.push_back(std::make_pair(piece_number, a_trans_mat));
         }
         logger::stream() << std::endl; logger::flush();
 
     }
+    
+    // With compact storage, draw the pieces one source image at a time, so that each image is read once
+    if (user_params.isCompactStorage()) {
+        std::stable_sort(layers.begin(), layers.end(), [&](const std::pair<int, cv::Mat>& a, const std::pair<int, cv::Mat>& b) {
+            return pieces[a.first].get_source_file() < pieces[b.first].get_source_file();
+        });
+    }
+    for (uint k = 0; k < layers.size(); k++) {
+        cv::Mat layer;
+        cv::Mat layer_mask;
+        
+        int layer_size = out_image_size;
+        
+        cv::warpAffine(pieces[layers[k].first].get_color(), layer, layers[k].second, cv::Size2i(layer_size,layer_size),cv::INTER_LINEAR,cv::BORDER_TRANSPARENT);
+        cv::warpAffine(pieces[layers[k].first].get_bw(), layer_mask, layers[k].second, cv::Size2i(layer_size,layer_size),cv::INTER_NEAREST,cv::BORDER_TRANSPARENT);
+        
+        layer.copyTo(out_image(cv::Rect(0,0,layer_size,layer_size)), layer_mask);
+    }
+    piece::release_source_image();
     if(failed){
         logger::stream() << "Failed, only partial image generated" << std::endl; logger::flush();
     }
@@ -15,11 +15,16 @@
 
 #include "compat_opencv.h"
 
+#include "contours.h"
 #include "edge.h"
 #include "params.h"
 #include "piece.h"
 #include "PuzzleDisjointSet.h"
+#include "score_table.h"
+#include "time_budget.h"
 
+class quantized_edges;
+class fft_edges;
 
 class puzzle{
 private:
@@ -30,19 +35,75 @@ private:
             return a.score<b.score;
         }
     };
+    // A block of edge pairs scored together by fill_costs(): edges [i_begin, i_end) paired with the
+    // edges [j_begin, j_end) which follow them.
+    struct score_tile {
+        int i_begin, i_end, j_begin, j_end;
+        long pairs; // number of pairs to score
+        double work; // estimated cost of scoring the pairs
+        static bool compare(const score_tile& a, const score_tile& b) {
+            return a.work > b.work;
+        }
+    };
+    // A solver configuration and, once it has been run, its outcome.
+    struct solve_config {
+        puzzle* owner;
+        params config_params;
+        uint tie_seed; // 0 keeps the sorted order of 'matches', otherwise near-ties are shuffled
+        int set_size;
+        int adjacent_pairs;
+        double total_score;
+        PuzzleDisjointSet::forest set;
+        solve_config(puzzle* owner, params& config_params, uint tie_seed);
+    };
     params& user_params;
     bool solved;
+    bool scoring_complete; // false if fill_costs() ran out of time before scoring every pair
     std::vector<match_score> matches;
+    score_table costs;
+    time_budget budget;
     std::vector<piece>  pieces;
     std::map<std::string,std::string> guided_matches;
     std::map<std::string,std::string> boundary_edges;
     cv::Mat_<int> solution;
     cv::Mat_<int> solution_rotations;    
+    // The already assembled region given by --seed-assembly, if any
+    cv::Mat_<int> seed_locations;
+    cv::Mat_<int> seed_rotations;
+    int seed_piece; // any piece in the seed assembly, or -1
+    std::vector<bool> seed_interior_edges; // true for edges which face another piece of the seed assembly
+    // Descriptors of the selected --score-engine, if it isn't exact
+    quantized_edges* quantized;
+    fft_edges* fft;
+    // Keys (smaller edge * number of edges + larger edge) of the pairs rescored by refine_candidates(), in order
+    std::vector<uint64_t> refined_pairs;
+    // Keys of the pairs retrieved by --ann-candidates, in order
+    std::vector<uint64_t> candidate_pairs;
     std::vector<piece> extract_pieces();
+    void process_pieces(std::vector<piece>& pieces);
+    void find_contours_coarse(cv::Mat& color_image, cv::Mat& coarse_bw, contour_mgr& contour_mgr);
+    void extract_image_pieces(uint i, const std::string& filename, cv::Mat& color_image, cv::Mat& bw_image, uint& piece_number, std::vector<piece>& pieces);
     void print_edges();
     std::string edgeType_to_s(edgeType e);
-    void auto_solve(PuzzleDisjointSet& p);
+    static bool match_check_function(void* data, int p1, int p2, int e1, int e2);
+    void auto_solve(PuzzleDisjointSet& p, solve_config& config);
+    void multi_start_solve();
+    void set_solution(PuzzleDisjointSet::forest& f);
+    double edge_score(int edge1, int edge2) const;
+    double edge_score(int edge1, int edge2, double& cscore, double& escore) const;
+    bool is_candidate(int edge1, int edge2) const;
+    bool within_limits(double score, double cscore, double escore, params& limits) const;
+    bool needs_score_table() const;
+    bool seed_frontier_scoring() const;
+    void extend_frontier_matches(PuzzleDisjointSet& p, std::vector<bool>& in_seed, std::vector<match_score>& frontier);
+    // Steps of fill_costs()
+    template<class score_function> void rescore_candidates(size_t base, score_function& score_pair);
+    void validate_scores();
+    void refine_candidates();
+    void init_costs();
     void load_guided_matches();
+    void load_seed_assembly();
+    void seed_set(PuzzleDisjointSet& p);
     void load_boundary_edges();
     void set_boundary_edge(int p1, int e1);
     bool is_boundary_edge(int p1, int e1);
@@ -50,8 +111,9 @@ private:
     std::string set_to_string(cv::Mat_<int> set, int offset);
 public:
     puzzle(params& userParams);
+    ~puzzle();
     std::string guide_match(int p1, int e1, int p2, int e2);    
-    bool check_match(int p1, int e1, int p2, int e2);    
+    bool check_match(int p1, int e1, int p2, int e2, params& limits);
     void fill_costs();
     void solve();
     void save_solution_text();
@@ -0,0 +1,87 @@
+/*
+ * quantized_edges.cpp
+ *
+ */
+
+#include "quantized_edges.h"
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+// Coordinates are clamped to 13 bits (+/-2047 pixels), so that the offset between a point and a reversed
+// point stays within 15 bits and the squared distance within 31 bits
+#define QUANTIZED_EDGE_LIMIT 8191
+
+static int16_t quantize(float value) {
+    int q = cvRound(value * QUANTIZED_EDGE_SCALE);
+    return (int16_t) std::max(-QUANTIZED_EDGE_LIMIT, std::min(QUANTIZED_EDGE_LIMIT, q));
+}
+
+quantized_edges::quantized_edges(std::vector<piece>& pieces) {
+    offsets.push_back(0);
+    for (uint i = 0; i < pieces.size(); i++) {
+        for (int j = 0; j < 4; j++) {
+            const std::vector<cv::Point2f>& contour = pieces[i].edges[j].get_normalized_contour();
+            for (uint k = 0; k < contour.size(); k++) {
+                coords.push_back(quantize(contour[k].x));
+                coords.push_back(quantize(contour[k].y));
+            }
+            offsets.push_back(coords.size());
+            corner_distances.push_back(pieces[i].edges[j].get_corner_distance());
+            types.push_back(pieces[i].edges[j].get_type());
+        }
+    }
+}
+
+double quantized_edges::compare(int edge1, int edge2) const {
+    double cscore;
+    double escore;
+    return compare(edge1, edge2, cscore, escore);
+}
+
+double quantized_edges::compare(int edge1, int edge2, double& cscore, double& escore) const {
+    if (types[edge1] == OUTER_EDGE || types[edge2] == OUTER_EDGE || types[edge1] == types[edge2]) {
+        cscore = 0.0;
+        escore = DBL_MAX;
+        return DBL_MAX;
+    }
+
+    double corners_diff = corner_distances[edge1] - corner_distances[edge2];
+    cscore = corners_diff * corners_diff;
+
+    const int16_t* a = &coords[offsets[edge1]];
+    const int16_t* a_end = &coords[0] + offsets[edge1 + 1];
+    const int16_t* b = &coords[offsets[edge2]];
+    const int16_t* b_end = &coords[0] + offsets[edge2 + 1];
+    if (a == a_end || b == b_end) {
+        escore = 0.0;
+        return cscore;
+    }
+    // Points of edge2's reverse normalized contour are its end point - each point of its normalized contour,
+    // so the offset from a point p of edge1 is p - (end - q) = (p - end) + q.
+    int end_x = b_end[-2];
+    int end_y = b_end[-1];
+
+    double sum = 0.0;
+    for (const int16_t* p = a; p != a_end; p += 2) {
+        int px = p[0] - end_x;
+        int py = p[1] - end_y;
+        uint32_t min = UINT32_MAX;
+        for (const int16_t* q = b; q != b_end; q += 2) {
+            int dx = px + q[0];
+            int dy = py + q[1];
+            uint32_t dist = dx * dx + dy * dy;
+            if (dist < min) min = dist;
+        }
+        sum += std::sqrt((double) min);
+    }
+
+    escore = sum / QUANTIZED_EDGE_SCALE;
+    return cscore + escore;
+}
+
+size_t quantized_edges::bytes() const {
+    return coords.size() * sizeof(int16_t) + offsets.size() * sizeof(uint)
+            + corner_distances.size() * sizeof(double) + types.size() * sizeof(edgeType);
+}
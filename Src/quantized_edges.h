@@ -0,0 +1,41 @@
+/*
+ * quantized_edges.h
+ *
+ * Fixed point copies of the normalized edge contours of every piece, stored contiguously so that the
+ * descriptors of a large puzzle stay cache resident while puzzle::fill_costs() scores every pair.
+ */
+
+#ifndef QUANTIZED_EDGES_H
+#define QUANTIZED_EDGES_H
+
+#include <vector>
+#include <stdint.h>
+#include "compat_opencv.h"
+#include "piece.h"
+
+// Coordinates are stored in units of 1/QUANTIZED_EDGE_SCALE pixels
+#define QUANTIZED_EDGE_SCALE 4
+
+class quantized_edges {
+private:
+    // Interleaved x, y coordinates of the normalized contour of each edge
+    std::vector<int16_t> coords;
+    // Index into coords of the first coordinate of each edge, plus one past the last edge
+    std::vector<uint> offsets;
+    std::vector<double> corner_distances;
+    std::vector<edgeType> types;
+public:
+    // Edges are numbered piece_index * 4 + edge_number.
+    quantized_edges(std::vector<piece>& pieces);
+
+    // Approximates edge::compare3(): the same squared corner distance difference plus the sum of the
+    // distances from each point of edge1 to the closest point of edge2 reversed, with the closest points
+    // found by integer squared distances.  Returns DBL_MAX for impossible pairs.
+    double compare(int edge1, int edge2) const;
+    double compare(int edge1, int edge2, double& cscore, double& escore) const;
+
+    // Size of the descriptors, in bytes.
+    size_t bytes() const;
+};
+
+#endif /* QUANTIZED_EDGES_H */
@@ -0,0 +1,169 @@
+/*
+ * score_table.cpp
+ *
+ */
+
+#include "score_table.h"
+
+#include <cfloat>
+#include <limits>
+#include <algorithm>
+
+const double score_table::IMPOSSIBLE_PENALTY = 1.0e7;
+
+score_table::score_table() {
+    no_edges = 0;
+}
+
+void score_table::init(int no_edges) {
+    this->no_edges = no_edges;
+    scores.assign((size_t) no_edges * no_edges, std::numeric_limits<float>::infinity());
+    std::vector<uint64_t>().swap(keys);
+    scorer = nullptr;
+}
+
+void score_table::init(int no_edges, const std::vector<std::pair<int, int> >& pairs) {
+    this->no_edges = no_edges;
+    keys.clear();
+    keys.reserve(pairs.size());
+    for (uint k = 0; k < pairs.size(); k++) {
+        keys.push_back(pair_key(pairs[k].first, pairs[k].second));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    scores.assign(keys.size(), std::numeric_limits<float>::infinity());
+    scorer = nullptr;
+}
+
+void score_table::init(int no_edges, std::function<double(int, int)> scorer) {
+    this->no_edges = no_edges;
+    std::vector<float>().swap(scores);
+    std::vector<uint64_t>().swap(keys);
+    this->scorer = scorer;
+}
+
+uint64_t score_table::pair_key(int edge1, int edge2) const {
+    return (uint64_t) std::min(edge1, edge2) * no_edges + std::max(edge1, edge2);
+}
+
+size_t score_table::index(int edge1, int edge2) const {
+    if (keys.empty()) {
+        return (size_t) edge1 * no_edges + edge2;
+    }
+    uint64_t key = pair_key(edge1, edge2);
+    std::vector<uint64_t>::const_iterator it = std::lower_bound(keys.begin(), keys.end(), key);
+    return (it == keys.end() || *it != key) ? SIZE_MAX : it - keys.begin();
+}
+
+size_t score_table::bytes() const {
+    return scores.size() * sizeof(float) + keys.size() * sizeof(uint64_t);
+}
+
+bool score_table::empty() const {
+    return no_edges == 0;
+}
+
+int score_table::edge_count() const {
+    return no_edges;
+}
+
+void score_table::set(int edge1, int edge2, double score) {
+    if (scorer) {
+        return;
+    }
+    float value = (score >= FLT_MAX) ? std::numeric_limits<float>::infinity() : (float) score;
+    if (!keys.empty()) {
+        size_t k = index(edge1, edge2);
+        if (k != SIZE_MAX) {
+            scores[k] = value;
+        }
+        return;
+    }
+    scores[(size_t) edge1 * no_edges + edge2] = value;
+    scores[(size_t) edge2 * no_edges + edge1] = value;
+}
+
+double score_table::get(int edge1, int edge2) const {
+    if (scorer) {
+        return scorer(edge1, edge2);
+    }
+    size_t k = index(edge1, edge2);
+    if (k == SIZE_MAX) {
+        return DBL_MAX;
+    }
+    float value = scores[k];
+    return (value == std::numeric_limits<float>::infinity()) ? DBL_MAX : value;
+}
+
+double score_table::pair_score(int edge1, int edge2) const {
+    double score = get(edge1, edge2);
+    return (score == DBL_MAX) ? IMPOSSIBLE_PENALTY : score;
+}
+
+int score_table::edge_at(int rotation, gridSide side) {
+    return (4 + side - rotation) % 4;
+}
+
+// Row and column offsets of the neighbouring cell on each side of a cell
+static const int side_row_offset[4] = { 0, 1, 0, -1 };
+static const int side_col_offset[4] = { -1, 0, 1, 0 };
+
+double score_table::grid_score(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations, int& pairs) const {
+    double total = 0.0;
+    pairs = 0;
+    for (int i = 0; i < locations.rows; i++) {
+        for (int j = 0; j < locations.cols; j++) {
+            int a = locations(i,j);
+            if (a == -1) {
+                continue;
+            }
+            // Only look right and down so that each adjacent pair is counted once.
+            for (int k = 0; k < 2; k++) {
+                int ni = (k == 0) ? i : i+1;
+                int nj = (k == 0) ? j+1 : j;
+                if (ni >= locations.rows || nj >= locations.cols || locations(ni,nj) == -1) {
+                    continue;
+                }
+                int b = locations(ni,nj);
+                int ea = a*4 + edge_at(rotations(i,j), (k == 0) ? SIDE_RIGHT : SIDE_BOTTOM);
+                int eb = b*4 + edge_at(rotations(ni,nj), (k == 0) ? SIDE_LEFT : SIDE_TOP);
+                total += pair_score(ea, eb);
+                pairs++;
+            }
+        }
+    }
+    return total;
+}
+
+double score_table::cell_score(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations, int row, int col) const {
+    int a = locations(row,col);
+    if (a == -1) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (int side = 0; side < 4; side++) {
+        int nrow = row + side_row_offset[side];
+        int ncol = col + side_col_offset[side];
+        if (nrow < 0 || ncol < 0 || nrow >= locations.rows || ncol >= locations.cols || locations(nrow,ncol) == -1) {
+            continue;
+        }
+        int ea = a*4 + edge_at(rotations(row,col), (gridSide) side);
+        int eb = locations(nrow,ncol)*4 + edge_at(rotations(nrow,ncol), (gridSide) ((side + 2) % 4));
+        total += pair_score(ea, eb);
+    }
+    return total;
+}
+
+double score_table::adjacent_score(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations, cv::Point a, cv::Point b) const {
+    if (locations(a.y,a.x) == -1 || locations(b.y,b.x) == -1) {
+        return 0.0;
+    }
+    for (int side = 0; side < 4; side++) {
+        if (a.y + side_row_offset[side] == b.y && a.x + side_col_offset[side] == b.x) {
+            int ea = locations(a.y,a.x)*4 + edge_at(rotations(a.y,a.x), (gridSide) side);
+            int eb = locations(b.y,b.x)*4 + edge_at(rotations(b.y,b.x), (gridSide) ((side + 2) % 4));
+            return pair_score(ea, eb);
+        }
+    }
+    return 0.0;
+}
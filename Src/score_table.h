@@ -0,0 +1,72 @@
+/*
+ * score_table.h
+ *
+ * Symmetric lookup of the edge-edge match scores computed by puzzle::fill_costs().  The scores are
+ * held in a dense table, held for a given set of pairs only, or computed when they are looked up.  Once filled, the table is only
+ * read, so it can be shared by solvers running concurrently.
+ */
+
+#ifndef SCORE_TABLE_H
+#define SCORE_TABLE_H
+
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include "compat_opencv.h"
+
+// Sides of a cell in a solution grid, numbered like the edges of an unrotated piece.
+enum gridSide { SIDE_LEFT = 0, SIDE_BOTTOM = 1, SIDE_RIGHT = 2, SIDE_TOP = 3 };
+
+class score_table {
+private:
+    int no_edges;
+    // no_edges x no_edges scores, stored as floats to keep large puzzles affordable.
+    std::vector<float> scores;
+    // With a sparse table, the keys (see pair_key()) of the pairs held, in increasing order, with their
+    // scores in 'scores'
+    std::vector<uint64_t> keys;
+    // Computes the score of a pair when there is no dense table
+    std::function<double(int, int)> scorer;
+
+    uint64_t pair_key(int edge1, int edge2) const;
+    // Index into 'scores' of a pair
+    size_t index(int edge1, int edge2) const;
+public:
+    // Penalty added by grid_score() for each pair of adjacent edges that can't possibly fit.
+    static const double IMPOSSIBLE_PENALTY;
+
+    score_table();
+    // A dense table, with every pair impossible until it is set.
+    void init(int no_edges);
+    // A sparse table holding only the given pairs (in either order).  Every other pair is impossible.
+    void init(int no_edges, const std::vector<std::pair<int, int> >& pairs);
+    // No table: every lookup calls scorer (which must be safe to call concurrently), and set() is ignored.
+    void init(int no_edges, std::function<double(int, int)> scorer);
+    bool empty() const;
+    int edge_count() const;
+    // Edges are numbered piece_index * 4 + edge_number.
+    void set(int edge1, int edge2, double score);
+    // Returns DBL_MAX for impossible (or unscored) pairs.
+    double get(int edge1, int edge2) const;
+    // Size of the table, in bytes
+    size_t bytes() const;
+
+    // Returns the number of the piece edge facing the given side of a grid cell, when the piece
+    // in that cell has the given rotation (as kept by PuzzleDisjointSet).
+    static int edge_at(int rotation, gridSide side);
+
+    // Returns the score of the given pair of edges, or IMPOSSIBLE_PENALTY if they can't fit together.
+    double pair_score(int edge1, int edge2) const;
+
+    // Sum of the scores of every pair of adjacent edges in an arrangement of pieces.  The number
+    // of adjacent pairs found is returned via 'pairs'.
+    double grid_score(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations, int& pairs) const;
+
+    // Sum of the scores of the pairs of adjacent edges around one cell of an arrangement.
+    double cell_score(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations, int row, int col) const;
+
+    // Score of the pair of edges joining two cells, or 0 if they aren't both occupied and adjacent.
+    double adjacent_score(const cv::Mat_<int>& locations, const cv::Mat_<int>& rotations, cv::Point a, cv::Point b) const;
+};
+
+#endif /* SCORE_TABLE_H */
@@ -0,0 +1,43 @@
+/*
+ * time_budget.cpp
+ *
+ */
+
+#include "time_budget.h"
+
+#include <cfloat>
+#include "omp.h"
+
+time_budget::time_budget() {
+    start_time = omp_get_wtime();
+    seconds = 0;
+}
+
+void time_budget::start(double seconds) {
+    this->start_time = omp_get_wtime();
+    this->seconds = seconds;
+}
+
+bool time_budget::limited() const {
+    return seconds > 0;
+}
+
+double time_budget::elapsed() const {
+    return omp_get_wtime() - start_time;
+}
+
+double time_budget::remaining() const {
+    if (!limited()) {
+        return DBL_MAX;
+    }
+    double left = seconds - elapsed();
+    return (left > 0) ? left : 0;
+}
+
+bool time_budget::expired() const {
+    return limited() && elapsed() >= seconds;
+}
+
+bool time_budget::expired(double fraction) const {
+    return limited() && elapsed() >= seconds * fraction;
+}
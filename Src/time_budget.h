@@ -0,0 +1,38 @@
+/*
+ * time_budget.h
+ *
+ */
+
+#ifndef TIME_BUDGET_H
+#define TIME_BUDGET_H
+
+/** @brief A wall-clock time budget shared by the phases of a run.
+
+The clock starts when start() is called.  A budget of zero (or less) seconds is unlimited, in which case
+expired() is always false.  All methods are safe to call from multiple threads once the budget has started.
+*/
+class time_budget {
+private:
+    double start_time;
+    double seconds;
+public:
+    time_budget();
+
+    void start(double seconds);
+
+    // True if the budget is limited
+    bool limited() const;
+
+    // Seconds since start() was called
+    double elapsed() const;
+
+    // Seconds left before the budget expires (a very large value if unlimited, 0 once expired)
+    double remaining() const;
+
+    bool expired() const;
+
+    // True once the given fraction of a limited budget has been used
+    bool expired(double fraction) const;
+};
+
+#endif /* TIME_BUDGET_H */
@@ -7,7 +7,10 @@
 //
 
 #include <math.h>
-#include <iomanip>
+#include <fstream>
+#include <sys/resource.h>
+#include <unordered_set>
+#include <algorithm>
 #include "utils.h"
 
 #include "compat_opencv.h"
@@ -18,10 +21,31 @@ void utils::line(cv::Mat mat, std::vector<cv::Point> points, int index1, int ind
     cv::line(mat, points[wrap_index(points, index1)], points[wrap_index(points, index2)], color);
 }
 
-//This function takes a directory, and returns a vector of every image opencv could extract from it.
-imlist utils::getImages(std::string path){
-    imlist v;
+// Returns true if the file starts with the signature of an image format that OpenCV can decode
+// (JPEG, PNG, TIFF, BMP, WebP, JPEG 2000, PBM/PGM/PPM, Sun raster, OpenEXR or Radiance HDR).
+bool utils::is_image_file(std::string filename) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    unsigned char h[12] = {0};
+    file.read((char*) h, sizeof(h));
+    std::streamsize n = file.gcount();
     
+    if (n >= 3 && h[0] == 0xFF && h[1] == 0xD8 && h[2] == 0xFF) return true;                           // JPEG
+    if (n >= 8 && memcmp(h, "\x89PNG\r\n\x1A\n", 8) == 0) return true;                                 // PNG
+    if (n >= 4 && (memcmp(h, "II*\0", 4) == 0 || memcmp(h, "MM\0*", 4) == 0)) return true;            // TIFF
+    if (n >= 2 && h[0] == 'B' && h[1] == 'M') return true;                                            // BMP
+    if (n >= 12 && memcmp(h, "RIFF", 4) == 0 && memcmp(h+8, "WEBP", 4) == 0) return true;             // WebP
+    if (n >= 12 && memcmp(h, "\0\0\0\x0CjP  ", 8) == 0) return true;                                   // JPEG 2000
+    if (n >= 4 && memcmp(h, "\xFF\x4F\xFF\x51", 4) == 0) return true;                                  // JPEG 2000 codestream
+    if (n >= 2 && h[0] == 'P' && h[1] >= '1' && h[1] <= '6') return true;                             // PBM/PGM/PPM
+    if (n >= 4 && memcmp(h, "\x59\xA6\x6A\x95", 4) == 0) return true;                                  // Sun raster
+    if (n >= 4 && memcmp(h, "\x76\x2F\x31\x01", 4) == 0) return true;                                  // OpenEXR
+    if (n >= 2 && h[0] == '#' && h[1] == '?') return true;                                            // Radiance HDR
+    return false;
+}
+
+// Returns the sorted pathnames of the image files in the directory.  Files that don't look like
+// images are skipped without being decoded.
+std::vector<std::string> utils::getImageFilenames(std::string path){
     DIR *dp;
     struct dirent *ep;
     dp = opendir (path.c_str());
@@ -43,24 +67,126 @@ imlist utils::getImages(std::string path){
     
     std::sort(filenames.begin(), filenames.end());
     
-    int id = 0;
+    std::vector<std::string> image_filenames;
     for (std::vector<std::string>::iterator i = filenames.begin(); i != filenames.end(); i++) {
-        std::string filename = *i;
-        cv::Mat image = cv::imread(filename);
-        if (image.data != NULL) {
-            id += 1;
-            logger::stream() << "Loaded " << filename << " as image " << std::setfill('0') << std::setw(3) << id << std::endl;
-            logger::flush();
-            v.push_back(image);
+        if (is_image_file(*i)) {
+            image_filenames.push_back(*i);
         }
+    }
+    return image_filenames;
+}
 
-        
+// Number of pixels around a region that the morphological filter in filter(bw,2) can draw on: one
+// for each of the erode and dilate steps of the open and close operations.
+#define PREPROCESS_FILTER_HALO 4
+
+// Produces the b/w version of a color image, by median blur followed by thresholding, or thresholding
+// followed by filter().
+cv::Mat utils::preprocess(cv::Mat color, int threshold, bool use_median_filter, int median_ksize) {
+    imlist image(1, color);
+    if (use_median_filter) {
+        return color_to_bw(median_blur(image, median_ksize), threshold)[0];
     }
+    imlist bw = color_to_bw(image, threshold);
+    filter(bw, 2);
+    return bw[0];
+}
+
+// Produces the b/w version of one region of a color image.  A halo of surrounding pixels (as far as
+// the blur or filter reaches) is processed with the region, and then discarded, so that the result is
+// identical to the same region of the b/w version of the whole image.
+cv::Mat utils::preprocess_region(const cv::Mat& color, cv::Rect region, int threshold, bool use_median_filter, int median_ksize) {
+    int halo = use_median_filter ? median_ksize / 2 : PREPROCESS_FILTER_HALO;
+    cv::Rect extended(region.x - halo, region.y - halo, region.width + 2*halo, region.height + 2*halo);
+    extended &= cv::Rect(0, 0, color.cols, color.rows);
+    // Copy so that the filters treat the edges of the extended region as image borders
+    cv::Mat bw = preprocess(color(extended).clone(), threshold, use_median_filter, median_ksize);
+    return bw(cv::Rect(region.x - extended.x, region.y - extended.y, region.width, region.height));
+}
+
+// Produces the same b/w image as preprocess(), but processes the image as tiles of tile_size x tile_size
+// pixels in parallel, writing each tile straight into the result.  Only the tiles' intermediate images
+// are allocated, rather than full size ones.
+cv::Mat utils::preprocess_tiled(const cv::Mat& color, int threshold, bool use_median_filter, int median_ksize, int tile_size) {
+    cv::Mat bw(color.rows, color.cols, CV_8UC1);
+    int tiles_x = (color.cols + tile_size - 1) / tile_size;
+    int tiles_y = (color.rows + tile_size - 1) / tile_size;
     
-    return v;
+#pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < tiles_x * tiles_y; t++) {
+        cv::Rect tile((t % tiles_x) * tile_size, (t / tiles_x) * tile_size, tile_size, tile_size);
+        tile &= cv::Rect(0, 0, color.cols, color.rows);
+        cv::Mat tile_bw = bw(tile);
+        preprocess_region(color, tile, threshold, use_median_filter, median_ksize).copyTo(tile_bw);
+    }
+    return bw;
 }
 
+//Adds the contours found in bw whose bounding boxes are at least min_size wide and high, translated by offset.
+static void add_large_contours(const cv::Mat& bw, int min_size, cv::Point offset, std::vector<std::vector<cv::Point> >& large_contours) {
+    std::vector<std::vector<cv::Point> > found_contours;
+    
+    //This isn't used but the opencv function wants it anyways.
+    std::vector<cv::Vec4i> hierarchy;
 
+    //Need to clone b/c it will get modified
+    cv::findContours(bw.clone(), found_contours, hierarchy, cv::RETR_LIST, cv::CHAIN_APPROX_NONE, offset);
+    
+    for (uint j = 0; j < found_contours.size(); j++) {
+        cv::Rect bounds = cv::boundingRect(found_contours[j]);
+        if (bounds.width < min_size || bounds.height < min_size) continue;
+        large_contours.push_back(found_contours[j]);
+    }
+}
+
+std::vector<std::vector<cv::Point> > utils::find_contours(const cv::Mat& bw, int min_size, bool prefilter, cv::Point offset) {
+    std::vector<std::vector<cv::Point> > large_contours;
+    
+#if OPENCV_VERSION_MAJOR == 2
+    // connectedComponentsWithStats() is not available
+    prefilter = false;
+#endif
+    if (!prefilter) {
+        add_large_contours(bw, min_size, offset, large_contours);
+        return large_contours;
+    }
+    
+#if OPENCV_VERSION_MAJOR != 2
+    cv::Mat labels;
+    cv::Mat stats;
+    cv::Mat centroids;
+    int count = cv::connectedComponentsWithStats(bw, labels, stats, centroids, 8, CV_32S);
+    
+    // Cut out a mask of each large enough component, so that the full size labels image can be released
+    // before any tracing.  Label 0 is the background.
+    std::vector<cv::Mat> components;
+    std::vector<cv::Point> origins;
+    for (int label = 1; label < count; label++) {
+        // A connected blob spanning min_size pixels has at least min_size pixels
+        if (stats.at<int>(label, cv::CC_STAT_AREA) < min_size 
+                || stats.at<int>(label, cv::CC_STAT_WIDTH) < min_size
+                || stats.at<int>(label, cv::CC_STAT_HEIGHT) < min_size) continue;
+        
+        // Only this component, within its bounding box.  Its holes are traced too, as they would be in
+        // the whole image.  The mask gets a one pixel background frame, as findContours() treats pixels
+        // on the image border differently, so the outline is traced as it would be in the whole image.
+        cv::Rect roi(stats.at<int>(label, cv::CC_STAT_LEFT), stats.at<int>(label, cv::CC_STAT_TOP),
+                stats.at<int>(label, cv::CC_STAT_WIDTH), stats.at<int>(label, cv::CC_STAT_HEIGHT));
+        cv::Mat component;
+        cv::compare(labels(roi), label, component, cv::CMP_EQ);
+        cv::Mat framed;
+        cv::copyMakeBorder(component, framed, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(0));
+        components.push_back(framed);
+        origins.push_back(roi.tl() - cv::Point(1, 1));
+    }
+    labels.release();
+    
+    for (uint k = 0; k < components.size(); k++) {
+        add_large_contours(components[k], min_size, offset + origins[k], large_contours);
+    }
+#endif
+    return large_contours;
+}
 
 //Easy way to take a list of images and create a bw image at a specified threshold.
 imlist utils::color_to_bw(imlist color, int threshold){
@@ -120,28 +246,19 @@ imlist utils::bilateral_blur(imlist to_blur){
     }
     return ret;
 }
+// Removes repeated points, keeping the first occurrence of each point and the order of the points.
 std::vector<cv::Point> utils::remove_duplicates(std::vector<cv::Point> vec){
-    bool dupes_found = true;
-    while(dupes_found){
-        dupes_found=false;
-        int dup_at=-1;
-        for(uint i =0; i<vec.size(); i++){
-            for(uint j=0; j<vec.size(); j++){
-                if(j==i) continue;
-                //                std::cout << vec[i] << " " << vec[j] << std::endl;
-                if(vec[i] == vec[j]){
-                    dup_at=j;
-                    dupes_found = true;
-                    vec.erase(vec.begin()+j);
-                    break;
-                }
-            }
-            if(dupes_found){
-                break;
-            }
+    std::unordered_set<uint64_t> seen;
+    seen.reserve(vec.size());
+    std::vector<cv::Point> unique;
+    unique.reserve(vec.size());
+    for(uint i =0; i<vec.size(); i++){
+        uint64_t key = ((uint64_t)(uint32_t) vec[i].x << 32) | (uint32_t) vec[i].y;
+        if(seen.insert(key).second){
+            unique.push_back(vec[i]);
         }
     }
-    return vec;
+    return unique;
 }
 
 void utils::write_img(params& user_params, cv::Mat& img, std::string filename) {
@@ -256,4 +373,55 @@ void utils::autocrop(cv::Mat& src, cv::Mat& dst)
     dst = src(win);
 }
 
+long utils::peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // ru_maxrss is in bytes on OSX, kilobytes elsewhere
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
 
+// Ranks of the values, with tied values given the average of their ranks
+static std::vector<double> ranks(const std::vector<double>& values) {
+    std::vector<size_t> order(values.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return values[a] < values[b];
+    });
+    std::vector<double> result(values.size());
+    for (size_t i = 0; i < order.size(); ) {
+        size_t j = i;
+        while (j + 1 < order.size() && values[order[j + 1]] == values[order[i]]) {
+            j++;
+        }
+        for (size_t k = i; k <= j; k++) {
+            result[order[k]] = (i + j) / 2.0;
+        }
+        i = j + 1;
+    }
+    return result;
+}
+
+double utils::rank_correlation(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<double> rank_a = ranks(a);
+    std::vector<double> rank_b = ranks(b);
+    double n = a.size();
+    double mean = (n - 1) / 2.0;
+    double covariance = 0.0;
+    double variance_a = 0.0;
+    double variance_b = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        covariance += (rank_a[i] - mean) * (rank_b[i] - mean);
+        variance_a += (rank_a[i] - mean) * (rank_a[i] - mean);
+        variance_b += (rank_b[i] - mean) * (rank_b[i] - mean);
+    }
+    if (variance_a == 0.0 || variance_b == 0.0) {
+        return 0.0;
+    }
+    return covariance / std::sqrt(variance_a * variance_b);
+}
@@ -99,10 +99,18 @@ public:
     
     static void filter(imlist to_filter, int size);
     static imlist color_to_bw(imlist color, int threshold);
-    static imlist getImages(std::string path);
+    static bool is_image_file(std::string filename);
+    static std::vector<std::string> getImageFilenames(std::string path);
     static imlist blur(imlist to_blur, int size, double sigma);
     static imlist median_blur(imlist to_blur, int size);
+    static cv::Mat preprocess(cv::Mat color, int threshold, bool use_median_filter, int median_ksize);
+    static cv::Mat preprocess_region(const cv::Mat& color, cv::Rect region, int threshold, bool use_median_filter, int median_ksize);
+    static cv::Mat preprocess_tiled(const cv::Mat& color, int threshold, bool use_median_filter, int median_ksize, int tile_size);
     static imlist bilateral_blur(imlist to_blur);
+    // Returns the contours in bw whose bounding boxes are at least min_size pixels wide and high, translated
+    // by offset.  With prefilter, connected components too small to produce such a contour are rejected
+    // from their pixel counts and bounding boxes before any contour is traced.
+    static std::vector<std::vector<cv::Point> > find_contours(const cv::Mat& bw, int min_size, bool prefilter, cv::Point offset = cv::Point());
     
     //template<class T> std::vector<cv::Point> translate_contour(std::vector<T> in , int offset_x, int offset_y);
     static std::vector<cv::Point> remove_duplicates(std::vector<cv::Point> vec);
@@ -131,6 +139,12 @@ public:
     static void write_debug_img(params& user_params, cv::Mat& img, std::string prefix, uint index1, uint index2);
 
     static void autocrop(cv::Mat& src, cv::Mat& dst);
+
+    // Returns the peak resident set size of the process, in kilobytes.
+    static long peak_rss_kb();
+
+    // Returns the Spearman rank correlation of two equally sized lists of values.
+    static double rank_correlation(const std::vector<double>& a, const std::vector<double>& b);
   
 
 };